@@ -0,0 +1,85 @@
+#include "flow_control.h"
+#include <stdexcept>
+
+namespace Net
+{
+
+void ReceiveFlowControl::pause(){
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPausedByUser = true;
+}
+
+void ReceiveFlowControl::resume(){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPausedByUser = false;
+    }
+    mCondition.notify_all();
+}
+
+void ReceiveFlowControl::setWatermarks(std::size_t highWatermark, std::size_t lowWatermark){
+    if (highWatermark != 0 && lowWatermark >= highWatermark)
+        throw std::runtime_error("Low watermark must be below high watermark");
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mHighWatermark = highWatermark;
+        mLowWatermark = lowWatermark;
+        if (highWatermark == 0)
+            mOutstandingBytes = 0;
+        updateBudgetState();
+    }
+    mCondition.notify_all();
+}
+
+void ReceiveFlowControl::delivered(std::size_t bytes){
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mHighWatermark == 0)
+        return;
+    mOutstandingBytes += bytes;
+    updateBudgetState();
+}
+
+void ReceiveFlowControl::consumed(std::size_t bytes){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mOutstandingBytes -= bytes < mOutstandingBytes ? bytes : mOutstandingBytes;
+        updateBudgetState();
+    }
+    mCondition.notify_all();
+}
+
+bool ReceiveFlowControl::paused() const{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPausedByUser || mPausedByBudget;
+}
+
+std::size_t ReceiveFlowControl::outstandingBytes() const{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mOutstandingBytes;
+}
+
+bool ReceiveFlowControl::waitUntilReadable(std::chrono::milliseconds timeout){
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (!mPausedByUser && !mPausedByBudget)
+        return true;
+    mCondition.wait_for(lock, timeout);
+    return !mPausedByUser && !mPausedByBudget;
+}
+
+void ReceiveFlowControl::wake(){
+    mCondition.notify_all();
+}
+
+void ReceiveFlowControl::updateBudgetState(){
+    if (mHighWatermark == 0){
+        mPausedByBudget = false;
+        return;
+    }
+    if (mOutstandingBytes >= mHighWatermark)
+        mPausedByBudget = true;
+    else if (mOutstandingBytes <= mLowWatermark)
+        mPausedByBudget = false;
+}
+
+}
@@ -0,0 +1,38 @@
+#ifndef FLOW_CONTROL_H
+#define FLOW_CONTROL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace Net
+{
+
+class ReceiveFlowControl{
+public:
+    void pause();
+    void resume();
+    void setWatermarks(std::size_t highWatermark, std::size_t lowWatermark);
+    void delivered(std::size_t bytes);
+    void consumed(std::size_t bytes);
+    bool paused() const;
+    std::size_t outstandingBytes() const;
+    bool waitUntilReadable(std::chrono::milliseconds timeout);
+    void wake();
+
+private:
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mPausedByUser{false};
+    bool mPausedByBudget{false};
+    std::size_t mHighWatermark{0};
+    std::size_t mLowWatermark{0};
+    std::size_t mOutstandingBytes{0};
+
+    void updateBudgetState();
+};
+
+}
+
+#endif // FLOW_CONTROL_H
@@ -0,0 +1,65 @@
+#ifndef NET_STATS_H
+#define NET_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace Net
+{
+
+struct DurationStatistics{
+    std::uint64_t count;
+    std::chrono::nanoseconds min;
+    std::chrono::nanoseconds max;
+    std::chrono::nanoseconds mean;
+};
+
+class DurationRecorder{
+public:
+    void record(std::chrono::nanoseconds duration) noexcept {
+        auto value = duration.count() < 0 ? 0 : static_cast<std::uint64_t>(duration.count());
+        mCount.fetch_add(1, std::memory_order_relaxed);
+        mTotal.fetch_add(value, std::memory_order_relaxed);
+        auto current = mMin.load(std::memory_order_relaxed);
+        while (value < current && !mMin.compare_exchange_weak(current, value, std::memory_order_relaxed));
+        current = mMax.load(std::memory_order_relaxed);
+        while (value > current && !mMax.compare_exchange_weak(current, value, std::memory_order_relaxed));
+    }
+
+    DurationStatistics statistics() const noexcept {
+        auto count = mCount.load(std::memory_order_relaxed);
+        if (count == 0)
+            return DurationStatistics{0, std::chrono::nanoseconds(0), std::chrono::nanoseconds(0), std::chrono::nanoseconds(0)};
+
+        return DurationStatistics{
+            count,
+            std::chrono::nanoseconds(mMin.load(std::memory_order_relaxed)),
+            std::chrono::nanoseconds(mMax.load(std::memory_order_relaxed)),
+            std::chrono::nanoseconds(mTotal.load(std::memory_order_relaxed) / count)
+        };
+    }
+
+    void reset() noexcept {
+        mCount.store(0, std::memory_order_relaxed);
+        mTotal.store(0, std::memory_order_relaxed);
+        mMin.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+        mMax.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t> mCount{0};
+    std::atomic<std::uint64_t> mTotal{0};
+    std::atomic<std::uint64_t> mMin{std::numeric_limits<std::uint64_t>::max()};
+    std::atomic<std::uint64_t> mMax{0};
+};
+
+struct ReceiveLatency{
+    DurationStatistics arrivalToDispatch;
+    DurationStatistics callback;
+};
+
+}
+
+#endif // NET_STATS_H
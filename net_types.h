@@ -9,6 +9,7 @@
 static_assert(false, "Unsupported platform");
 #endif
 
+#include <chrono>
 #include <vector>
 #include <string>
 
@@ -18,6 +19,7 @@ namespace Net
 using PortNumberType = unsigned short;
 using Byte = unsigned char;
 using ByteBuffer = std::vector<Byte>;
+using TimePoint = std::chrono::system_clock::time_point;
 
 inline ByteBuffer to_byte_buffer(std::string text){
     auto nullTerminatedSize = text.size()+1;
@@ -33,12 +35,19 @@ inline std::string convert_to_string(const ByteBuffer &buffer){
 }
 
 constexpr std::size_t RECEIVE_BUFFER_LEN = 512;
+constexpr std::chrono::milliseconds FLOW_CONTROL_POLL_INTERVAL{100};
+constexpr std::chrono::milliseconds SEND_QUEUE_DRAIN_TIMEOUT{1000};
 
 enum class SocketSide{
     Server,
     Client
 };
 
+enum class SlowClientPolicy{
+    DropFrames,
+    Disconnect
+};
+
 enum class SocketType: int {
     TCP = 0,
     UDP = 1
@@ -0,0 +1,179 @@
+#include "pacing.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+
+namespace Net
+{
+
+TokenBucket::TokenBucket(std::uint64_t bytesPerSecond, std::uint64_t burstBytes):
+    mRate(bytesPerSecond),
+    mBurst(std::max<std::uint64_t>(burstBytes, 1)),
+    mTokens(static_cast<double>(mBurst)),
+    mLastRefill(std::chrono::steady_clock::now()){
+    if (bytesPerSecond == 0)
+        throw std::runtime_error("Pacing rate must be positive");
+}
+
+void TokenBucket::setRate(std::uint64_t bytesPerSecond, std::uint64_t burstBytes){
+    if (bytesPerSecond == 0)
+        throw std::runtime_error("Pacing rate must be positive");
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    refill(std::chrono::steady_clock::now());
+    mRate = bytesPerSecond;
+    mBurst = std::max<std::uint64_t>(burstBytes, 1);
+    mTokens = std::min(mTokens, static_cast<double>(mBurst));
+}
+
+std::uint64_t TokenBucket::rate() const{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRate;
+}
+
+std::chrono::nanoseconds TokenBucket::acquire(std::size_t bytes){
+    std::lock_guard<std::mutex> lock(mMutex);
+    refill(std::chrono::steady_clock::now());
+
+    // Messages larger than the burst are let through once the bucket is full
+    // and leave it in debt, so they are paced instead of blocked forever.
+    auto required = std::min(static_cast<double>(bytes), static_cast<double>(mBurst));
+    if (mTokens >= required){
+        mTokens -= static_cast<double>(bytes);
+        return std::chrono::nanoseconds(0);
+    }
+    auto missing = required - mTokens;
+    return std::chrono::nanoseconds(static_cast<std::int64_t>(missing * 1e9 / static_cast<double>(mRate)) + 1);
+}
+
+void TokenBucket::refill(std::chrono::steady_clock::time_point now){
+    auto elapsed = std::chrono::duration<double>(now - mLastRefill).count();
+    mLastRefill = now;
+    mTokens = std::min(mTokens + elapsed * static_cast<double>(mRate), static_cast<double>(mBurst));
+}
+
+SendQueue::SendQueue(std::shared_ptr<TokenBucket> rateLimiter, std::size_t capacity, ThreadConfig sendThread):
+    mRateLimiter(rateLimiter),
+    mCapacity(capacity),
+    mThreadConfig(sendThread){
+    startSendLoop();
+}
+
+SendQueue::~SendQueue(){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopped = true;
+        mStatistics.discarded += mItems.size();
+        mItems.clear();
+    }
+    mCondition.notify_all();
+    try{
+        if (mSendThread.joinable())
+            mSendThread.join();
+    }
+    catch (std::system_error &){
+        assert(false);
+    }
+}
+
+void SendQueue::setRateLimiter(std::shared_ptr<TokenBucket> rateLimiter){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRateLimiter = rateLimiter;
+    }
+    mCondition.notify_all();
+}
+
+void SendQueue::setCapacity(std::size_t capacity){
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCapacity = capacity;
+}
+
+void SendQueue::setErrorCallback(std::function<void (const std::string &)> callback){
+    std::lock_guard<std::mutex> lock(mMutex);
+    errorCallback = callback;
+}
+
+bool SendQueue::enqueue(std::size_t bytes, std::function<void()> sendOperation){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mClosed || (mCapacity > 0 && mItems.size() >= mCapacity)){
+            ++mStatistics.rejected;
+            return false;
+        }
+        mItems.push_back(Item{bytes, std::move(sendOperation), std::chrono::steady_clock::now()});
+        mStatistics.peakDepth = std::max(mStatistics.peakDepth, mItems.size());
+    }
+    mCondition.notify_one();
+    return true;
+}
+
+bool SendQueue::close(std::chrono::milliseconds drainTimeout){
+    std::unique_lock<std::mutex> lock(mMutex);
+    mClosed = true;
+    return mDrainedCondition.wait_for(lock, drainTimeout, [this](){
+        return mItems.empty() && !mSending;
+    });
+}
+
+std::size_t SendQueue::size() const{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mItems.size();
+}
+
+SendQueueStatistics SendQueue::statistics() const{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto statistics = mStatistics;
+    statistics.depth = mItems.size();
+    return statistics;
+}
+
+DurationStatistics SendQueue::queueDelay() const{
+    return mQueueDelay.statistics();
+}
+
+void SendQueue::startSendLoop(){
+    mSendThread = std::thread([=](){
+        apply_thread_config(IoThreadRole::Send, mThreadConfig);
+        std::unique_lock<std::mutex> lock(mMutex);
+        while(!mStopped){
+            if (mItems.empty()){
+                mCondition.wait(lock);
+                continue;
+            }
+            if (mRateLimiter){
+                auto wait = mRateLimiter->acquire(mItems.front().bytes);
+                if (wait.count() > 0){
+                    mCondition.wait_for(lock, wait);
+                    continue;
+                }
+            }
+            auto item = std::move(mItems.front());
+            mItems.pop_front();
+            mSending = true;
+            lock.unlock();
+            mQueueDelay.record(std::chrono::steady_clock::now() - item.enqueued);
+            try{
+                item.send();
+            }
+            catch (std::runtime_error &e){
+                lock.lock();
+                ++mStatistics.failed;
+                auto callback = errorCallback;
+                lock.unlock();
+                if (callback)
+                    callback(e.what());
+                else
+                    std::cerr<< "Failed to send queued data: " << e.what() <<std::endl;
+            }
+            lock.lock();
+            mSending = false;
+            if (mItems.empty())
+                mDrainedCondition.notify_all();
+        }
+    });
+}
+
+}
@@ -0,0 +1,90 @@
+#ifndef PACING_H
+#define PACING_H
+
+#include "net_stats.h"
+#include "thread_config.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Net
+{
+
+class TokenBucket{
+public:
+    TokenBucket(std::uint64_t bytesPerSecond, std::uint64_t burstBytes);
+    TokenBucket(const TokenBucket &) = delete;
+    TokenBucket& operator=(const TokenBucket &) = delete;
+    void setRate(std::uint64_t bytesPerSecond, std::uint64_t burstBytes);
+    std::uint64_t rate() const;
+    std::chrono::nanoseconds acquire(std::size_t bytes);
+
+private:
+    mutable std::mutex mMutex;
+    std::uint64_t mRate;
+    std::uint64_t mBurst;
+    double mTokens;
+    std::chrono::steady_clock::time_point mLastRefill;
+
+    void refill(std::chrono::steady_clock::time_point);
+};
+
+struct SendQueueStatistics{
+    std::size_t depth;
+    std::size_t peakDepth;
+    std::uint64_t rejected;
+    std::uint64_t failed;
+    std::uint64_t discarded;
+};
+
+// Items still queued when the queue is destroyed are discarded; close() first
+// to give them a bounded time to be sent.
+class SendQueue{
+public:
+    SendQueue(std::shared_ptr<TokenBucket> = nullptr, std::size_t capacity = 0, ThreadConfig sendThread = get_thread_config(IoThreadRole::Send));
+    SendQueue(const SendQueue &) = delete;
+    SendQueue& operator=(const SendQueue &) = delete;
+    ~SendQueue();
+    void setRateLimiter(std::shared_ptr<TokenBucket>);
+    void setCapacity(std::size_t);
+    void setErrorCallback(std::function<void(const std::string &)>);
+    bool enqueue(std::size_t bytes, std::function<void()> sendOperation);
+    bool close(std::chrono::milliseconds drainTimeout);
+    std::size_t size() const;
+    SendQueueStatistics statistics() const;
+    DurationStatistics queueDelay() const;
+
+private:
+    struct Item{
+        std::size_t bytes;
+        std::function<void()> send;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::condition_variable mDrainedCondition;
+    std::deque<Item> mItems;
+    std::shared_ptr<TokenBucket> mRateLimiter;
+    std::size_t mCapacity;
+    std::function<void(const std::string &)> errorCallback;
+    SendQueueStatistics mStatistics{0, 0, 0, 0, 0};
+    bool mSending{false};
+    bool mClosed{false};
+    bool mStopped{false};
+    DurationRecorder mQueueDelay;
+    ThreadConfig mThreadConfig;
+    std::thread mSendThread;
+
+    void startSendLoop();
+};
+
+}
+
+#endif // PACING_H
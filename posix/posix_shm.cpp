@@ -0,0 +1,137 @@
+#include "posix_shm.h"
+
+#ifdef POSIX_OS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <new>
+#include <thread>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <ctime>
+#endif
+
+namespace Net
+{
+
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "Futex word must be a plain 32-bit integer");
+
+    static std::string shm_object_name(const std::string &name){
+        if (!name.empty() && name[0] == '/')
+            return name;
+        return std::string("/") + name;
+    }
+
+    static shared_memory_ptr shm_map(int fd, std::size_t size, int protection = PROT_READ | PROT_WRITE) noexcept {
+        auto address = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED)
+            return shared_memory_ptr(nullptr, shm_release);
+
+        return shared_memory_ptr(new (std::nothrow) shared_memory_t{address, size}, shm_release);
+    }
+
+    void shm_release(shared_memory_t *memory) noexcept {
+        if (memory == nullptr)
+            return;
+        munmap(memory->address, memory->size);
+        delete memory;
+    }
+
+    shared_memory_ptr shm_create(const std::string &name, std::size_t size) noexcept {
+        auto objectName = shm_object_name(name);
+        auto fd = shm_open(objectName.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+        if (fd == -1)
+            return shared_memory_ptr(nullptr, shm_release);
+
+        if (ftruncate(fd, static_cast<off_t>(size)) == -1){
+            close(fd);
+            shm_unlink(objectName.c_str());
+            return shared_memory_ptr(nullptr, shm_release);
+        }
+        return shm_map(fd, size);
+    }
+
+    shared_memory_ptr shm_attach(const std::string &name) noexcept {
+        auto fd = shm_open(shm_object_name(name).c_str(), O_RDWR, 0);
+        if (fd == -1)
+            return shared_memory_ptr(nullptr, shm_release);
+
+        struct stat status;
+        if (fstat(fd, &status) == -1 || status.st_size <= 0){
+            close(fd);
+            return shared_memory_ptr(nullptr, shm_release);
+        }
+        return shm_map(fd, static_cast<std::size_t>(status.st_size));
+    }
+
+    void shm_remove(const std::string &name) noexcept {
+        shm_unlink(shm_object_name(name).c_str());
+    }
+
+    std::int32_t current_process_id() noexcept {
+        return static_cast<std::int32_t>(getpid());
+    }
+
+    bool process_alive(std::int32_t pid) noexcept {
+        if (pid <= 0)
+            return false;
+        return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+    }
+
+    shared_memory_ptr file_map_create(const std::string &path, std::size_t size) noexcept {
+        auto fd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP);
+        if (fd == -1)
+            return shared_memory_ptr(nullptr, shm_release);
+
+        if (ftruncate(fd, static_cast<off_t>(size)) == -1){
+            close(fd);
+            return shared_memory_ptr(nullptr, shm_release);
+        }
+        return shm_map(fd, size);
+    }
+
+    shared_memory_ptr file_map_open(const std::string &path) noexcept {
+        auto fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            return shared_memory_ptr(nullptr, shm_release);
+
+        struct stat status;
+        if (fstat(fd, &status) == -1 || status.st_size <= 0){
+            close(fd);
+            return shared_memory_ptr(nullptr, shm_release);
+        }
+        return shm_map(fd, static_cast<std::size_t>(status.st_size), PROT_READ);
+    }
+
+#if defined(__linux__)
+    bool futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected, std::chrono::microseconds timeout) noexcept {
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        timespec waitTime;
+        waitTime.tv_sec = static_cast<time_t>(seconds.count());
+        waitTime.tv_nsec = static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - seconds).count());
+        return syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT, expected, &waitTime, nullptr, 0) == 0;
+    }
+
+    void futex_wake(std::atomic<std::uint32_t> &word) noexcept {
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+    }
+#else
+    bool futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected, std::chrono::microseconds timeout) noexcept {
+        auto pollInterval = std::chrono::microseconds(50);
+        if (word.load() == expected)
+            std::this_thread::sleep_for(timeout < pollInterval ? timeout : pollInterval);
+        return word.load() != expected;
+    }
+
+    void futex_wake(std::atomic<std::uint32_t> &) noexcept {
+    }
+#endif
+
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef POSIX_SHM_H
+#define POSIX_SHM_H
+
+#include "../net_types.h"
+
+#ifdef POSIX_OS
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Net
+{
+
+    struct shared_memory_t{
+        void *address;
+        std::size_t size;
+    };
+
+    void shm_release(shared_memory_t *) noexcept;
+
+    using shared_memory_ptr = std::unique_ptr<shared_memory_t, decltype(&shm_release)>;
+
+    shared_memory_ptr shm_create(const std::string &name, std::size_t size) noexcept;
+    shared_memory_ptr shm_attach(const std::string &name) noexcept;
+    void shm_remove(const std::string &name) noexcept;
+    std::int32_t current_process_id() noexcept;
+    bool process_alive(std::int32_t pid) noexcept;
+    shared_memory_ptr file_map_create(const std::string &path, std::size_t size) noexcept;
+    shared_memory_ptr file_map_open(const std::string &path) noexcept;
+
+    bool futex_wait(std::atomic<std::uint32_t> &, std::uint32_t expected, std::chrono::microseconds timeout) noexcept;
+    void futex_wake(std::atomic<std::uint32_t> &) noexcept;
+
+}
+
+#endif
+#endif // POSIX_SHM_H
@@ -3,11 +3,23 @@
 
 #ifdef POSIX_OS
 #include <unistd.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 #include "errno.h"
 
 namespace Net
 {
 
+#ifdef MSG_NOSIGNAL
+    static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    static constexpr int SEND_FLAGS = 0;
+#endif
+
     static void addrinfo_empty_deleter(addrinfo*){
 
     }
@@ -63,6 +75,32 @@ namespace Net
         return res;
     }
 
+    bool get_endpoint(const addr_info_ptr &address_info, std::string &address, PortNumberType &port) noexcept {
+        if (!address_info || address_info->ai_addr == nullptr || address_info->ai_addr->sa_family != AF_INET)
+            return false;
+        auto socketAddress = reinterpret_cast<const sockaddr_in *>(address_info->ai_addr);
+        char buffer[INET_ADDRSTRLEN];
+        if (inet_ntop(AF_INET, &socketAddress->sin_addr, buffer, sizeof(buffer)) == nullptr)
+            return false;
+        address = buffer;
+        port = ntohs(socketAddress->sin_port);
+        return true;
+    }
+
+    bool get_peer_endpoint(const socket_t &socket, std::string &address, PortNumberType &port) noexcept {
+        sockaddr_storage peer;
+        socklen_t length = sizeof(peer);
+        if (socket == -1 || getpeername(socket, reinterpret_cast<sockaddr *>(&peer), &length) == -1 || peer.ss_family != AF_INET)
+            return false;
+        auto socketAddress = reinterpret_cast<const sockaddr_in *>(&peer);
+        char buffer[INET_ADDRSTRLEN];
+        if (inet_ntop(AF_INET, &socketAddress->sin_addr, buffer, sizeof(buffer)) == nullptr)
+            return false;
+        address = buffer;
+        port = ntohs(socketAddress->sin_port);
+        return true;
+    }
+
     socket_t create_socket(const addr_info_ptr &address_info) noexcept {
         assert(address_info);
         return socket(address_info->ai_family, address_info->ai_socktype, address_info->ai_protocol);
@@ -142,11 +180,84 @@ namespace Net
         return message;
     }
 
+    static ByteBuffer socket_receive_message(socket_t &socket, sockaddr *address, socklen_t *address_length, TimePoint &timestamp){
+        assert(socket != -1);
+        char recvbuf[RECEIVE_BUFFER_LEN];
+        iovec vector;
+        vector.iov_base = recvbuf;
+        vector.iov_len = RECEIVE_BUFFER_LEN;
+
+        union {
+            char buffer[CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(timeval))];
+            cmsghdr align;
+        } control;
+
+        msghdr header;
+        memset(&header, 0, sizeof(header));
+        header.msg_name = address;
+        header.msg_namelen = address_length != nullptr ? *address_length : 0;
+        header.msg_iov = &vector;
+        header.msg_iovlen = 1;
+        header.msg_control = control.buffer;
+        header.msg_controllen = sizeof(control.buffer);
+
+        auto messageLength = recvmsg(socket, &header, 0);
+        timestamp = std::chrono::system_clock::now();
+        if (address_length != nullptr)
+            *address_length = header.msg_namelen;
+        if (messageLength == 0)
+            return ByteBuffer();
+        if (messageLength<0){
+            auto err = get_last_error();
+            if (err == ECONNRESET)
+                return ByteBuffer();
+            throw std::runtime_error(std::string("Receive error code: ")+std::to_string(err));
+        }
+
+        for (auto message = CMSG_FIRSTHDR(&header); message != nullptr; message = CMSG_NXTHDR(&header, message)){
+            if (message->cmsg_level != SOL_SOCKET)
+                continue;
+#ifdef SCM_TIMESTAMPNS
+            if (message->cmsg_type == SCM_TIMESTAMPNS){
+                timespec kernelTime;
+                memcpy(&kernelTime, CMSG_DATA(message), sizeof(kernelTime));
+                timestamp = TimePoint(std::chrono::duration_cast<TimePoint::duration>(
+                                std::chrono::seconds(kernelTime.tv_sec) + std::chrono::nanoseconds(kernelTime.tv_nsec)));
+                break;
+            }
+#endif
+            if (message->cmsg_type == SCM_TIMESTAMP){
+                timeval kernelTime;
+                memcpy(&kernelTime, CMSG_DATA(message), sizeof(kernelTime));
+                timestamp = TimePoint(std::chrono::duration_cast<TimePoint::duration>(
+                                std::chrono::seconds(kernelTime.tv_sec) + std::chrono::microseconds(kernelTime.tv_usec)));
+                break;
+            }
+        }
+
+        ByteBuffer message(messageLength);
+        auto byteBuffer = reinterpret_cast<Byte *>(recvbuf);
+        std::copy(byteBuffer, byteBuffer+messageLength, message.begin());
+
+        return message;
+    }
+
+    ByteBuffer socket_receive(socket_t &socket, TimePoint &timestamp){
+        return socket_receive_message(socket, nullptr, nullptr, timestamp);
+    }
+
+    ByteBuffer socket_receive_from(socket_t &socket, addr_info_ptr &addr_info, TimePoint &timestamp){
+        socklen_t len = sizeof(sockaddr_storage);
+        auto message = socket_receive_message(socket, addr_info.get()->ai_addr, &len, timestamp);
+        addr_info.get()->ai_addrlen = len;
+        return message;
+    }
+
     bool socket_send(socket_t &socket, const ByteBuffer &message) noexcept {
         assert(socket != -1);
         auto sendBuffer = reinterpret_cast<const char *>(message.data());
         auto bufferLength = static_cast<int>(message.size());
-        if (send(socket, sendBuffer, bufferLength, 0) == -1) {
+        if (send(socket, sendBuffer, bufferLength, SEND_FLAGS) == -1) {
             return false;
         }
         return true;
@@ -167,6 +278,30 @@ namespace Net
         return true;
     }
 
+    bool socket_connection_lost(socket_t &socket) noexcept {
+        assert(socket != -1);
+        pollfd descriptor;
+        descriptor.fd = socket;
+#ifdef POLLRDHUP
+        descriptor.events = POLLRDHUP;
+        const short peerClosed = POLLRDHUP;
+#else
+        descriptor.events = POLLIN;
+        const short peerClosed = POLLIN;
+#endif
+        descriptor.revents = 0;
+        if (poll(&descriptor, 1, 0) == -1)
+            return false;
+        if ((descriptor.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+            return true;
+        if ((descriptor.revents & peerClosed) == 0)
+            return false;
+        // A graceful close is only reported once the data received before
+        // it has been read.
+        char next;
+        return recv(socket, &next, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+    }
+
     bool socket_shutdown(socket_t &socket) noexcept {
         assert(socket != -1);
         if (shutdown(socket, SHUT_RDWR) == -1)
@@ -178,8 +313,116 @@ namespace Net
         close(socket);
     }
 
-}
+    static bool parse_ipv4(const std::string &address, in_addr &result) noexcept {
+        if (address.empty()){
+            result.s_addr = htonl(INADDR_ANY);
+            return true;
+        }
+        return inet_pton(AF_INET, address.c_str(), &result) == 1;
+    }
+
+    static bool socket_group_membership(socket_t &socket, int option, const std::string &group, const std::string &interface_address) noexcept {
+        assert(socket != -1);
+        ip_mreq request;
+        memset(&request, 0, sizeof(request));
+        if (group.empty() || !parse_ipv4(group, request.imr_multiaddr) || !parse_ipv4(interface_address, request.imr_interface))
+            return false;
+        return setsockopt(socket, IPPROTO_IP, option, &request, sizeof(request)) != -1;
+    }
 
+    static bool socket_source_group_membership(socket_t &socket, int option, const std::string &group, const std::string &source, const std::string &interface_address) noexcept {
+        assert(socket != -1);
+        ip_mreq_source request;
+        memset(&request, 0, sizeof(request));
+        if (group.empty() || source.empty()
+                || !parse_ipv4(group, request.imr_multiaddr)
+                || !parse_ipv4(source, request.imr_sourceaddr)
+                || !parse_ipv4(interface_address, request.imr_interface))
+            return false;
+        return setsockopt(socket, IPPROTO_IP, option, &request, sizeof(request)) != -1;
+    }
+
+    bool socket_set_reuse_address(socket_t &socket) noexcept {
+        assert(socket != -1);
+        int enable = 1;
+        if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == -1)
+            return false;
+#ifdef SO_REUSEPORT
+        if (setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) == -1)
+            return false;
 #endif
+        return true;
+    }
+
+    bool socket_join_group(socket_t &socket, const std::string &group, const std::string &interface_address) noexcept {
+        return socket_group_membership(socket, IP_ADD_MEMBERSHIP, group, interface_address);
+    }
+
+    bool socket_leave_group(socket_t &socket, const std::string &group, const std::string &interface_address) noexcept {
+        return socket_group_membership(socket, IP_DROP_MEMBERSHIP, group, interface_address);
+    }
+
+    bool socket_join_source_group(socket_t &socket, const std::string &group, const std::string &source, const std::string &interface_address) noexcept {
+        return socket_source_group_membership(socket, IP_ADD_SOURCE_MEMBERSHIP, group, source, interface_address);
+    }
 
+    bool socket_leave_source_group(socket_t &socket, const std::string &group, const std::string &source, const std::string &interface_address) noexcept {
+        return socket_source_group_membership(socket, IP_DROP_SOURCE_MEMBERSHIP, group, source, interface_address);
+    }
 
+    bool socket_set_multicast_interface(socket_t &socket, const std::string &interface_address) noexcept {
+        assert(socket != -1);
+        in_addr address;
+        if (!parse_ipv4(interface_address, address))
+            return false;
+        return setsockopt(socket, IPPROTO_IP, IP_MULTICAST_IF, &address, sizeof(address)) != -1;
+    }
+
+    bool socket_set_multicast_ttl(socket_t &socket, int ttl) noexcept {
+        assert(socket != -1);
+        if (ttl < 0 || ttl > 255)
+            return false;
+        auto value = static_cast<unsigned char>(ttl);
+        return setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL, &value, sizeof(value)) != -1;
+    }
+
+    bool socket_set_multicast_loopback(socket_t &socket, bool enable) noexcept {
+        assert(socket != -1);
+        unsigned char value = enable ? 1 : 0;
+        return setsockopt(socket, IPPROTO_IP, IP_MULTICAST_LOOP, &value, sizeof(value)) != -1;
+    }
+
+    bool socket_enable_timestamps(socket_t &socket) noexcept {
+        assert(socket != -1);
+        int enable = 1;
+#ifdef SO_TIMESTAMPNS
+        return setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) != -1;
+#else
+        return setsockopt(socket, SOL_SOCKET, SO_TIMESTAMP, &enable, sizeof(enable)) != -1;
+#endif
+    }
+
+    bool socket_set_max_pacing_rate(socket_t &socket, std::uint64_t bytes_per_second) noexcept {
+        assert(socket != -1);
+#ifdef SO_MAX_PACING_RATE
+        auto rate = static_cast<unsigned int>(std::min<std::uint64_t>(bytes_per_second, std::numeric_limits<unsigned int>::max()));
+        return setsockopt(socket, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) != -1;
+#else
+        (void)bytes_per_second;
+        return false;
+#endif
+    }
+
+    bool socket_set_incoming_cpu(socket_t &socket, int cpu) noexcept {
+        assert(socket != -1);
+#ifdef SO_INCOMING_CPU
+        return setsockopt(socket, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) != -1;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+
+}
+
+#endif
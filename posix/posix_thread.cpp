@@ -0,0 +1,51 @@
+#include "posix_thread.h"
+
+#ifdef POSIX_OS
+#include <pthread.h>
+#include <sched.h>
+
+namespace Net
+{
+
+    bool thread_set_name(const std::string &name) noexcept {
+#if defined(__APPLE__)
+        return pthread_setname_np(name.substr(0, 63).c_str()) == 0;
+#else
+        return pthread_setname_np(pthread_self(), name.substr(0, 15).c_str()) == 0;
+#endif
+    }
+
+    bool thread_set_affinity(const std::vector<int> &cpus) noexcept {
+#if defined(__linux__) && !defined(__ANDROID__)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (auto cpu : cpus){
+            if (cpu < 0 || cpu >= CPU_SETSIZE)
+                return false;
+            CPU_SET(cpu, &cpuSet);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#elif defined(__ANDROID__)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (auto cpu : cpus){
+            if (cpu < 0 || cpu >= CPU_SETSIZE)
+                return false;
+            CPU_SET(cpu, &cpuSet);
+        }
+        return sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0;
+#else
+        (void)cpus;
+        return false;
+#endif
+    }
+
+    bool thread_set_fifo_priority(int priority) noexcept {
+        sched_param parameters;
+        parameters.sched_priority = priority;
+        return pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters) == 0;
+    }
+
+}
+
+#endif
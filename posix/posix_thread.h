@@ -0,0 +1,21 @@
+#ifndef POSIX_THREAD_H
+#define POSIX_THREAD_H
+
+#include "../net_types.h"
+
+#ifdef POSIX_OS
+
+#include <string>
+#include <vector>
+
+namespace Net
+{
+
+    bool thread_set_name(const std::string &) noexcept;
+    bool thread_set_affinity(const std::vector<int> &cpus) noexcept;
+    bool thread_set_fifo_priority(int priority) noexcept;
+
+}
+
+#endif
+#endif // POSIX_THREAD_H
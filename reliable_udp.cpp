@@ -0,0 +1,459 @@
+#include "reliable_udp.h"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+namespace Net
+{
+
+namespace
+{
+
+enum class PacketType: Byte {
+    Data = 1,
+    Ack = 2,
+    Forward = 3
+};
+
+constexpr std::size_t FAST_RETRANSMIT_THRESHOLD = 3;
+constexpr std::size_t SACK_RANGE = 64;
+constexpr double MIN_CONGESTION_WINDOW = 2;
+constexpr double INITIAL_CONGESTION_WINDOW = 10;
+constexpr double MAX_CONGESTION_WINDOW = 4096;
+constexpr double PACING_GAIN = 1.25;
+constexpr std::uint64_t INITIAL_PACING_RATE = 10 * 1024 * 1024;
+constexpr std::uint64_t MIN_PACING_RATE = 64 * 1024;
+constexpr std::uint64_t PACING_BURST = 8 * RECEIVE_BUFFER_LEN;
+constexpr std::chrono::microseconds MIN_RETRANSMIT_TIMEOUT{20000};
+constexpr std::chrono::microseconds INITIAL_RETRANSMIT_TIMEOUT{200000};
+constexpr std::chrono::microseconds MAX_RETRANSMIT_TIMEOUT{2000000};
+constexpr std::chrono::milliseconds TIMER_INTERVAL{5};
+constexpr std::size_t RETIRED_SESSION_HISTORY = 16;
+
+void put_u32(Byte *destination, std::uint32_t value){
+    for (int i = 3; i >= 0; --i, value >>= 8)
+        destination[i] = static_cast<Byte>(value & 0xFF);
+}
+
+void put_u64(Byte *destination, std::uint64_t value){
+    for (int i = 7; i >= 0; --i, value >>= 8)
+        destination[i] = static_cast<Byte>(value & 0xFF);
+}
+
+std::uint32_t get_u32(const Byte *source){
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+        value = (value << 8) | source[i];
+    return value;
+}
+
+std::uint64_t get_u64(const Byte *source){
+    std::uint64_t value = 0;
+    for (int i = 0; i < 8; ++i)
+        value = (value << 8) | source[i];
+    return value;
+}
+
+ByteBuffer make_packet(PacketType type, std::uint64_t session, std::uint32_t time, std::uint64_t first, std::uint64_t second, std::size_t payloadLength = 0){
+    ByteBuffer packet(RELIABLE_UDP_HEADER_LEN + payloadLength);
+    packet[0] = static_cast<Byte>(type);
+    put_u32(&packet[4], time);
+    put_u64(&packet[8], first);
+    put_u64(&packet[16], second);
+    put_u64(&packet[24], session);
+    return packet;
+}
+
+std::uint64_t new_session_id(){
+    std::random_device device;
+    std::uint64_t session = 0;
+    while (session == 0){
+        session = (static_cast<std::uint64_t>(device()) << 32) ^ device()
+                ^ static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+    return session;
+}
+
+}
+
+ReliableUdpChannel::ReliableUdpChannel(PortNumberType localPort, std::string remoteAddress, PortNumberType remotePort, ThreadConfig timerThread):
+    mEpoch(Clock::now()),
+    mCongestionWindow(INITIAL_CONGESTION_WINDOW),
+    mSlowStartThreshold(MAX_CONGESTION_WINDOW),
+    mRetransmitTimeout(INITIAL_RETRANSMIT_TIMEOUT),
+    mPacer(std::make_shared<TokenBucket>(INITIAL_PACING_RATE, PACING_BURST)),
+    mLocalSession(new_session_id()),
+    mSimulation{0.0, 0.0, std::chrono::milliseconds(0), 0},
+    mStatistics{0, 0, 0, 0, 0, 0, 0, std::chrono::microseconds(0), INITIAL_CONGESTION_WINDOW},
+    mTimerThreadConfig(timerThread),
+    mSocket(localPort){
+    auto remote = get_addr_info(SocketType::UDP, remotePort, remoteAddress);
+    if (!remote || !get_endpoint(remote, mRemoteAddress, mRemotePort) || !mSocket.setDestination(remoteAddress, remotePort))
+        throw std::runtime_error("Unable to create address info");
+
+    mSocket.setRateLimiter(mPacer);
+    mSocket.setDataReceivedCallback([=](ByteBuffer data, std::string address, PortNumberType port){
+        if (address != mRemoteAddress || port != mRemotePort)
+            return;
+        onPacket(std::move(data));
+    });
+    startTimerLoop();
+}
+
+ReliableUdpChannel::~ReliableUdpChannel(){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopped = true;
+    }
+    mTimerCondition.notify_all();
+    try{
+        if (mTimerThread.joinable())
+            mTimerThread.join();
+    }
+    catch (std::system_error &){
+        assert(false);
+    }
+}
+
+void ReliableUdpChannel::send(const ByteBuffer &data){
+    if (data.size() > RELIABLE_UDP_MAX_PAYLOAD)
+        throw std::runtime_error("Message is too large for reliable datagram");
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto now = Clock::now();
+    mPending.emplace_back(now, data);
+    sendPending(now);
+}
+
+void ReliableUdpChannel::setDataReceivedCallback(std::function<void (ByteBuffer)> callback){
+    std::lock_guard<std::mutex> lock(mMutex);
+    dataReceivedCallback = callback;
+}
+
+void ReliableUdpChannel::setReliabilityDeadline(std::chrono::milliseconds deadline){
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDeadline = deadline;
+}
+
+void ReliableUdpChannel::setLossSimulation(LossSimulation simulation){
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSimulation = simulation;
+    mRandom.seed(simulation.seed);
+}
+
+ReliableUdpStatistics ReliableUdpChannel::statistics() const{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto statistics = mStatistics;
+    statistics.smoothedRtt = mSmoothedRtt;
+    statistics.congestionWindow = mCongestionWindow;
+    return statistics;
+}
+
+std::uint32_t ReliableUdpChannel::timestamp(Clock::time_point time) const{
+    return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(time - mEpoch).count());
+}
+
+std::uint64_t ReliableUdpChannel::forwardPoint() const{
+    return mUnacked.empty() ? mNextSequence : mUnacked.begin()->first;
+}
+
+void ReliableUdpChannel::transmit(const ByteBuffer &packet){
+    if (mSimulation.lossRate > 0 || mSimulation.reorderRate > 0){
+        std::uniform_real_distribution<double> distribution(0.0, 1.0);
+        if (distribution(mRandom) < mSimulation.lossRate)
+            return;
+        if (distribution(mRandom) < mSimulation.reorderRate){
+            mDelayed.emplace(Clock::now() + mSimulation.reorderDelay, packet);
+            return;
+        }
+    }
+    mSocket.send(packet);
+}
+
+void ReliableUdpChannel::sendData(ByteBuffer payload){
+    auto now = Clock::now();
+    auto forward = forwardPoint();
+    auto sequence = mNextSequence++;
+    auto packet = make_packet(PacketType::Data, mLocalSession, timestamp(now), sequence, forward, payload.size());
+    std::copy(payload.begin(), payload.end(), packet.begin() + RELIABLE_UDP_HEADER_LEN);
+    transmit(packet);
+    mUnacked.emplace(sequence, OutstandingPacket{std::move(packet), now, now, 0, false});
+    ++mStatistics.packetsSent;
+}
+
+void ReliableUdpChannel::retransmit(OutstandingPacket &outstanding, Clock::time_point now){
+    put_u32(&outstanding.packet[4], timestamp(now));
+    put_u64(&outstanding.packet[16], forwardPoint());
+    outstanding.lastSent = now;
+    transmit(outstanding.packet);
+    ++mStatistics.packetsSent;
+}
+
+void ReliableUdpChannel::sendPending(Clock::time_point now){
+    while (!mPending.empty() && mUnacked.size() < static_cast<std::size_t>(mCongestionWindow)){
+        auto pending = std::move(mPending.front());
+        mPending.pop_front();
+        if (mDeadline.count() > 0 && now - pending.first > mDeadline){
+            ++mStatistics.abandoned;
+            continue;
+        }
+        sendData(std::move(pending.second));
+    }
+}
+
+void ReliableUdpChannel::sendAck(std::uint32_t echo){
+    std::uint64_t selective = 0;
+    for (auto it = mOutOfOrder.upper_bound(mExpected); it != mOutOfOrder.end() && it->first <= mExpected + SACK_RANGE; ++it)
+        selective |= std::uint64_t(1) << (it->first - mExpected - 1);
+    transmit(make_packet(PacketType::Ack, mPeerSession, echo, mExpected, selective));
+}
+
+void ReliableUdpChannel::sendForward(){
+    transmit(make_packet(PacketType::Forward, mLocalSession, timestamp(Clock::now()), forwardPoint(), 0));
+}
+
+void ReliableUdpChannel::handleAck(const ByteBuffer &packet, Clock::time_point now){
+    auto echo = get_u32(&packet[4]);
+    auto cumulative = get_u64(&packet[8]);
+    auto selective = get_u64(&packet[16]);
+
+    auto rtt = static_cast<std::uint32_t>(timestamp(now) - echo);
+    updateRtt(std::chrono::microseconds(rtt));
+
+    std::size_t newlyAcked = 0;
+    while (!mUnacked.empty() && mUnacked.begin()->first < cumulative){
+        mUnacked.erase(mUnacked.begin());
+        ++newlyAcked;
+    }
+    auto highestAcked = cumulative;
+    for (std::size_t bit = 0; bit < SACK_RANGE; ++bit){
+        if ((selective & (std::uint64_t(1) << bit)) == 0)
+            continue;
+        highestAcked = cumulative + 1 + bit;
+        newlyAcked += mUnacked.erase(highestAcked);
+    }
+
+    auto lossDetected = false;
+    for (auto it = mUnacked.begin(); it != mUnacked.end() && it->first < highestAcked; ++it){
+        auto &outstanding = it->second;
+        if (outstanding.fastRetransmitted || ++outstanding.laterAcks < FAST_RETRANSMIT_THRESHOLD)
+            continue;
+        outstanding.fastRetransmitted = true;
+        retransmit(outstanding, now);
+        ++mStatistics.fastRetransmissions;
+        if (it->first >= mRecoveryPoint)
+            lossDetected = true;
+    }
+
+    if (lossDetected){
+        mSlowStartThreshold = std::max(mCongestionWindow / 2, MIN_CONGESTION_WINDOW);
+        mCongestionWindow = mSlowStartThreshold;
+        mRecoveryPoint = mNextSequence;
+    }
+    else{
+        for (std::size_t i = 0; i < newlyAcked; ++i){
+            if (mCongestionWindow < mSlowStartThreshold)
+                mCongestionWindow += 1;
+            else
+                mCongestionWindow += 1 / mCongestionWindow;
+        }
+        mCongestionWindow = std::min(mCongestionWindow, MAX_CONGESTION_WINDOW);
+    }
+    updatePacer();
+    sendPending(now);
+}
+
+// A new session id from the peer means it restarted and numbers its packets
+// from zero again, so receive state of the previous session is dropped.
+// Late packets of retired sessions are ignored instead of resetting again.
+bool ReliableUdpChannel::acceptSession(std::uint64_t session){
+    if (session == mPeerSession)
+        return true;
+    if (session == 0 || std::find(mRetiredSessions.begin(), mRetiredSessions.end(), session) != mRetiredSessions.end())
+        return false;
+
+    if (mPeerSession != 0){
+        mRetiredSessions.push_back(mPeerSession);
+        if (mRetiredSessions.size() > RETIRED_SESSION_HISTORY)
+            mRetiredSessions.pop_front();
+        mExpected = 0;
+        mOutOfOrder.clear();
+        mGapOpen = false;
+        ++mStatistics.peerRestarts;
+    }
+    mPeerSession = session;
+    return true;
+}
+
+void ReliableUdpChannel::skipTo(std::uint64_t sequence){
+    while (mExpected < sequence){
+        auto buffered = mOutOfOrder.begin();
+        if (buffered == mOutOfOrder.end() || buffered->first >= sequence){
+            mStatistics.skipped += sequence - mExpected;
+            mExpected = sequence;
+            break;
+        }
+        mStatistics.skipped += buffered->first - mExpected;
+        mDeliveries.push_back(std::move(buffered->second));
+        mExpected = buffered->first + 1;
+        mOutOfOrder.erase(buffered);
+    }
+}
+
+void ReliableUdpChannel::deliverInOrder(Clock::time_point now){
+    auto advanced = false;
+    while (!mOutOfOrder.empty() && mOutOfOrder.begin()->first <= mExpected){
+        auto buffered = mOutOfOrder.begin();
+        if (buffered->first == mExpected){
+            mDeliveries.push_back(std::move(buffered->second));
+            ++mExpected;
+            advanced = true;
+        }
+        mOutOfOrder.erase(buffered);
+    }
+    if (mOutOfOrder.empty()){
+        mGapOpen = false;
+    }
+    else if (advanced || !mGapOpen){
+        mGapOpen = true;
+        mGapSince = now;
+    }
+}
+
+void ReliableUdpChannel::dispatchDeliveries(std::unique_lock<std::mutex> &lock){
+    if (mDelivering)
+        return;
+
+    mDelivering = true;
+    while (!mDeliveries.empty()){
+        std::vector<ByteBuffer> deliveries;
+        deliveries.swap(mDeliveries);
+        mStatistics.delivered += deliveries.size();
+        auto callback = dataReceivedCallback;
+        lock.unlock();
+        if (callback){
+            for (auto &data : deliveries)
+                callback(std::move(data));
+        }
+        lock.lock();
+    }
+    mDelivering = false;
+}
+
+void ReliableUdpChannel::updateRtt(std::chrono::microseconds rtt){
+    if (!mHasRttSample){
+        mSmoothedRtt = rtt;
+        mRttVariance = rtt / 2;
+        mHasRttSample = true;
+    }
+    else{
+        auto deviation = mSmoothedRtt > rtt ? mSmoothedRtt - rtt : rtt - mSmoothedRtt;
+        mRttVariance = (3 * mRttVariance + deviation) / 4;
+        mSmoothedRtt = (7 * mSmoothedRtt + rtt) / 8;
+    }
+    mRetransmitTimeout = std::min(std::max(mSmoothedRtt + 4 * mRttVariance, MIN_RETRANSMIT_TIMEOUT), MAX_RETRANSMIT_TIMEOUT);
+}
+
+void ReliableUdpChannel::updatePacer(){
+    if (!mHasRttSample)
+        return;
+
+    auto rttSeconds = std::max(std::chrono::duration<double>(mSmoothedRtt).count(), 1e-4);
+    auto rate = PACING_GAIN * mCongestionWindow * RECEIVE_BUFFER_LEN / rttSeconds;
+    mPacer->setRate(std::max(static_cast<std::uint64_t>(rate), MIN_PACING_RATE), PACING_BURST);
+}
+
+void ReliableUdpChannel::onPacket(ByteBuffer packet){
+    if (packet.size() < RELIABLE_UDP_HEADER_LEN)
+        return;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto now = Clock::now();
+    auto session = get_u64(&packet[24]);
+    switch (static_cast<PacketType>(packet[0])){
+    case PacketType::Data:{
+        if (!acceptSession(session))
+            return;
+        auto sequence = get_u64(&packet[8]);
+        skipTo(get_u64(&packet[16]));
+        if (sequence >= mExpected && mOutOfOrder.find(sequence) == mOutOfOrder.end())
+            mOutOfOrder.emplace(sequence, ByteBuffer(packet.begin() + RELIABLE_UDP_HEADER_LEN, packet.end()));
+        deliverInOrder(now);
+        sendAck(get_u32(&packet[4]));
+        break;
+    }
+    case PacketType::Forward:
+        if (!acceptSession(session))
+            return;
+        skipTo(get_u64(&packet[8]));
+        deliverInOrder(now);
+        break;
+    case PacketType::Ack:
+        if (session != mLocalSession)
+            return;
+        handleAck(packet, now);
+        break;
+    default:
+        return;
+    }
+    dispatchDeliveries(lock);
+}
+
+void ReliableUdpChannel::onTimer(Clock::time_point now){
+    while (!mDelayed.empty() && mDelayed.begin()->first <= now){
+        mSocket.send(mDelayed.begin()->second);
+        mDelayed.erase(mDelayed.begin());
+    }
+
+    auto abandoned = false;
+    auto timedOut = false;
+    for (auto it = mUnacked.begin(); it != mUnacked.end();){
+        auto &outstanding = it->second;
+        if (mDeadline.count() > 0 && now - outstanding.firstSent > mDeadline){
+            it = mUnacked.erase(it);
+            ++mStatistics.abandoned;
+            abandoned = true;
+            continue;
+        }
+        if (now - outstanding.lastSent >= mRetransmitTimeout){
+            retransmit(outstanding, now);
+            ++mStatistics.retransmissions;
+            timedOut = true;
+        }
+        ++it;
+    }
+
+    if (timedOut){
+        mSlowStartThreshold = std::max(mCongestionWindow / 2, MIN_CONGESTION_WINDOW);
+        mCongestionWindow = MIN_CONGESTION_WINDOW;
+        mRetransmitTimeout = std::min(mRetransmitTimeout * 2, MAX_RETRANSMIT_TIMEOUT);
+        mRecoveryPoint = mNextSequence;
+        updatePacer();
+    }
+    if (abandoned)
+        sendForward();
+    sendPending(now);
+
+    if (mDeadline.count() > 0 && mGapOpen && now - mGapSince > mDeadline){
+        skipTo(mOutOfOrder.begin()->first);
+        deliverInOrder(now);
+    }
+}
+
+void ReliableUdpChannel::startTimerLoop(){
+    mTimerThread = std::thread([=](){
+        apply_thread_config(IoThreadRole::Timer, mTimerThreadConfig);
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mStopped){
+            mTimerCondition.wait_for(lock, TIMER_INTERVAL);
+            if (mStopped)
+                return;
+            onTimer(Clock::now());
+            dispatchDeliveries(lock);
+        }
+    });
+}
+
+}
@@ -0,0 +1,123 @@
+#ifndef RELIABLE_UDP_H
+#define RELIABLE_UDP_H
+
+#include "socket.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace Net
+{
+
+constexpr std::size_t RELIABLE_UDP_HEADER_LEN = 32;
+constexpr std::size_t RELIABLE_UDP_MAX_PAYLOAD = RECEIVE_BUFFER_LEN - RELIABLE_UDP_HEADER_LEN;
+
+struct ReliableUdpStatistics{
+    std::uint64_t packetsSent;
+    std::uint64_t retransmissions;
+    std::uint64_t fastRetransmissions;
+    std::uint64_t abandoned;
+    std::uint64_t delivered;
+    std::uint64_t skipped;
+    std::uint64_t peerRestarts;
+    std::chrono::microseconds smoothedRtt;
+    double congestionWindow;
+};
+
+struct LossSimulation{
+    double lossRate;
+    double reorderRate;
+    std::chrono::milliseconds reorderDelay;
+    unsigned seed;
+};
+
+class ReliableUdpChannel{
+public:
+    ReliableUdpChannel(PortNumberType localPort, std::string remoteAddress, PortNumberType remotePort,
+                       ThreadConfig timerThread = get_thread_config(IoThreadRole::Timer));
+    ReliableUdpChannel(const ReliableUdpChannel &) = delete;
+    ReliableUdpChannel& operator=(const ReliableUdpChannel &) = delete;
+    ~ReliableUdpChannel();
+    void send(const ByteBuffer &);
+    void setDataReceivedCallback(std::function<void(ByteBuffer)>);
+    void setReliabilityDeadline(std::chrono::milliseconds);
+    void setLossSimulation(LossSimulation);
+    ReliableUdpStatistics statistics() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct OutstandingPacket{
+        ByteBuffer packet;
+        Clock::time_point firstSent;
+        Clock::time_point lastSent;
+        std::size_t laterAcks;
+        bool fastRetransmitted;
+    };
+
+    mutable std::mutex mMutex;
+    std::condition_variable mTimerCondition;
+    bool mStopped{false};
+    Clock::time_point mEpoch;
+    std::chrono::microseconds mDeadline{0};
+    std::function<void(ByteBuffer)> dataReceivedCallback;
+
+    std::uint64_t mNextSequence{0};
+    std::uint64_t mRecoveryPoint{0};
+    std::map<std::uint64_t, OutstandingPacket> mUnacked;
+    std::deque<std::pair<Clock::time_point, ByteBuffer>> mPending;
+    double mCongestionWindow;
+    double mSlowStartThreshold;
+    bool mHasRttSample{false};
+    std::chrono::microseconds mSmoothedRtt{0};
+    std::chrono::microseconds mRttVariance{0};
+    std::chrono::microseconds mRetransmitTimeout;
+    std::shared_ptr<TokenBucket> mPacer;
+
+    std::uint64_t mLocalSession;
+    std::uint64_t mPeerSession{0};
+    std::deque<std::uint64_t> mRetiredSessions;
+    std::uint64_t mExpected{0};
+    std::map<std::uint64_t, ByteBuffer> mOutOfOrder;
+    bool mGapOpen{false};
+    Clock::time_point mGapSince;
+    std::vector<ByteBuffer> mDeliveries;
+    bool mDelivering{false};
+
+    LossSimulation mSimulation;
+    std::mt19937 mRandom;
+    std::multimap<Clock::time_point, ByteBuffer> mDelayed;
+    ReliableUdpStatistics mStatistics;
+
+    std::string mRemoteAddress;
+    PortNumberType mRemotePort;
+    ThreadConfig mTimerThreadConfig;
+    std::thread mTimerThread;
+    UdpSocket mSocket;
+
+    std::uint32_t timestamp(Clock::time_point) const;
+    std::uint64_t forwardPoint() const;
+    void transmit(const ByteBuffer &);
+    void sendData(ByteBuffer payload);
+    void retransmit(OutstandingPacket &, Clock::time_point);
+    void sendPending(Clock::time_point);
+    void sendAck(std::uint32_t echo);
+    void sendForward();
+    void handleAck(const ByteBuffer &, Clock::time_point);
+    bool acceptSession(std::uint64_t session);
+    void skipTo(std::uint64_t sequence);
+    void deliverInOrder(Clock::time_point);
+    void dispatchDeliveries(std::unique_lock<std::mutex> &);
+    void updateRtt(std::chrono::microseconds);
+    void updatePacer();
+    void onPacket(ByteBuffer);
+    void onTimer(Clock::time_point);
+    void startTimerLoop();
+};
+
+}
+
+#endif // RELIABLE_UDP_H
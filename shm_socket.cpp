@@ -0,0 +1,439 @@
+#include "socket.h"
+
+#if defined(POSIX_OS)
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+namespace Net
+{
+
+namespace
+{
+
+constexpr std::uint32_t SHM_LISTEN_MAGIC = 0x4e4d4c53;
+constexpr std::uint32_t SHM_CONNECTION_MAGIC = 0x4e4d4353;
+constexpr std::size_t SHM_ACCEPT_BACKLOG = 64;
+constexpr std::size_t SHM_RECORD_HEADER_LEN = 8;
+constexpr std::uint32_t SHM_WRAP_MARKER = 0xFFFFFFFF;
+constexpr std::chrono::microseconds SHM_WAIT_TIMEOUT{100000};
+constexpr std::chrono::microseconds SHM_CONNECT_TIMEOUT{5000000};
+
+struct ShmRing{
+    alignas(64) std::atomic<std::uint64_t> head;
+    std::atomic<std::uint32_t> dataSignal;
+    std::atomic<std::uint32_t> consumerWaiting;
+    alignas(64) std::atomic<std::uint64_t> tail;
+    std::atomic<std::uint32_t> spaceSignal;
+    std::atomic<std::uint32_t> producerWaiting;
+};
+
+struct ShmConnectionHeader{
+    std::atomic<std::uint32_t> magic;
+    std::atomic<std::uint32_t> accepted;
+    std::atomic<std::uint32_t> serverClosed;
+    std::atomic<std::uint32_t> clientClosed;
+    std::atomic<std::int32_t> serverPid;
+    std::atomic<std::int32_t> clientPid;
+    std::uint64_t ringCapacity;
+    ShmRing toServer;
+    ShmRing toClient;
+};
+
+struct ShmListenHeader{
+    std::atomic<std::uint32_t> magic;
+    std::atomic<std::uint32_t> closed;
+    std::atomic<std::int32_t> ownerPid;
+    std::atomic<std::uint32_t> nextConnectionId;
+    std::atomic<std::uint32_t> requestSignal;
+    std::atomic<std::uint32_t> slots[SHM_ACCEPT_BACKLOG];
+};
+
+constexpr std::size_t SHM_CONNECTION_HEADER_LEN = (sizeof(ShmConnectionHeader) + 63) & ~std::size_t(63);
+
+std::size_t ring_capacity(std::size_t requested){
+    std::size_t capacity = 4096;
+    while (capacity < requested)
+        capacity <<= 1;
+    return capacity;
+}
+
+ShmConnectionHeader *connection_header(const shared_memory_ptr &memory){
+    return reinterpret_cast<ShmConnectionHeader *>(memory->address);
+}
+
+ShmRing &receive_ring(ShmConnectionHeader *header, SocketSide side){
+    return side == SocketSide::Server ? header->toServer : header->toClient;
+}
+
+ShmRing &send_ring(ShmConnectionHeader *header, SocketSide side){
+    return side == SocketSide::Server ? header->toClient : header->toServer;
+}
+
+Byte *receive_data(const shared_memory_ptr &memory, SocketSide side){
+    auto base = reinterpret_cast<Byte *>(memory->address) + SHM_CONNECTION_HEADER_LEN;
+    return side == SocketSide::Server ? base : base + connection_header(memory)->ringCapacity;
+}
+
+Byte *send_data(const shared_memory_ptr &memory, SocketSide side){
+    auto base = reinterpret_cast<Byte *>(memory->address) + SHM_CONNECTION_HEADER_LEN;
+    return side == SocketSide::Server ? base + connection_header(memory)->ringCapacity : base;
+}
+
+bool peer_closed(ShmConnectionHeader *header, SocketSide side){
+    return (side == SocketSide::Server ? header->clientClosed : header->serverClosed).load() != 0;
+}
+
+// Catches a peer that exited without setting its closed flag. Only checked
+// after a wait timed out, so the hot path never pays for the syscall.
+bool peer_alive(ShmConnectionHeader *header, SocketSide side){
+    auto pid = (side == SocketSide::Server ? header->clientPid : header->serverPid).load();
+    return pid == 0 || process_alive(pid);
+}
+
+void signal(std::atomic<std::uint32_t> &signal, std::atomic<std::uint32_t> &waiting){
+    signal.fetch_add(1);
+    if (waiting.load() != 0)
+        futex_wake(signal);
+}
+
+bool listener_alive(ShmListenHeader *header){
+    return header->closed.load() == 0 && process_alive(header->ownerPid.load());
+}
+
+// A listen segment left behind by a server that exited without unlinking it
+// is recognised by its owner pid no longer running and is re-created.
+shared_memory_ptr create_listen_segment(const std::string &name){
+    auto memory = shm_create(name, sizeof(ShmListenHeader));
+    if (memory)
+        return memory;
+
+    auto existing = shm_attach(name);
+    if (!existing || existing->size < sizeof(ShmListenHeader))
+        return memory;
+    auto header = reinterpret_cast<ShmListenHeader *>(existing->address);
+    if (header->magic.load() != SHM_LISTEN_MAGIC || listener_alive(header))
+        return memory;
+
+    shm_remove(name);
+    return shm_create(name, sizeof(ShmListenHeader));
+}
+
+}
+
+ShmServerSocket::ShmServerSocket(std::string name, ThreadConfig acceptThread):
+    mName(name),
+    mMemory(create_listen_segment(name)),
+    mThreadConfig(acceptThread),
+    mClientThreadConfig(get_thread_config(IoThreadRole::ShmReceive)){
+    if (!mMemory)
+        throw std::runtime_error("Unable to create shared memory segment");
+
+    auto header = new (mMemory->address) ShmListenHeader();
+    header->closed.store(0);
+    header->ownerPid.store(current_process_id());
+    header->nextConnectionId.store(0);
+    header->requestSignal.store(0);
+    for (auto &slot : header->slots)
+        slot.store(0);
+    header->magic.store(SHM_LISTEN_MAGIC);
+}
+
+ShmServerSocket::~ShmServerSocket(){
+    auto header = reinterpret_cast<ShmListenHeader *>(mMemory->address);
+    header->closed.store(1);
+    header->requestSignal.fetch_add(1);
+    futex_wake(header->requestSignal);
+    try{
+        isAccepting.store(false);
+        if (acceptLoop.joinable())
+            acceptLoop.join();
+    }
+    catch (std::system_error &){
+        assert(false);
+    }
+    shm_remove(mName);
+}
+
+void ShmServerSocket::startListen(){
+    if (listening)
+        return;
+
+    listening = true;
+    startAcceptLoop();
+}
+
+void ShmServerSocket::setClientConnectedCallback(std::function<void(std::unique_ptr<ShmClientSocket>)> callback){
+    clientConnectedCallback = callback;
+}
+
+void ShmServerSocket::setClientThreadConfig(ThreadConfig receiveThread){
+    if (listening)
+        throw std::runtime_error("Client thread config must be set before listening");
+
+    mClientThreadConfig = receiveThread;
+}
+
+void ShmServerSocket::startAcceptLoop(){
+    acceptLoop = std::thread([=](){
+        apply_thread_config(IoThreadRole::ShmAccept, mThreadConfig);
+        auto header = reinterpret_cast<ShmListenHeader *>(mMemory->address);
+        while(isAccepting.load()){
+            auto requestSignal = header->requestSignal.load();
+            auto accepted = false;
+            for (auto &slot : header->slots){
+                auto request = slot.load();
+                if (request == 0)
+                    continue;
+                accepted = true;
+                auto connectionName = mName + "_" + std::to_string(request - 1);
+                auto memory = shm_attach(connectionName);
+                shm_remove(connectionName);
+                slot.compare_exchange_strong(request, 0);
+                if (!memory || memory->size < SHM_CONNECTION_HEADER_LEN
+                        || connection_header(memory)->magic.load() != SHM_CONNECTION_MAGIC
+                        || memory->size < SHM_CONNECTION_HEADER_LEN + 2 * connection_header(memory)->ringCapacity)
+                    continue;
+                try{
+                    std::unique_ptr<ShmClientSocket> acceptedClient(new ShmClientSocket(std::move(memory), mClientThreadConfig));
+                    if (clientConnectedCallback) clientConnectedCallback(std::move(acceptedClient));
+                }
+                catch (std::runtime_error &e){
+                    std::cerr<< "Failed to create client socket: " << e.what() <<std::endl;
+                    assert(false);
+                }
+            }
+            if (!accepted)
+                futex_wait(header->requestSignal, requestSignal, SHM_WAIT_TIMEOUT);
+        }
+    });
+}
+
+ShmClientSocket::ShmClientSocket(shared_memory_ptr &&memory, ThreadConfig receiveThread):
+    mSide(SocketSide::Server),
+    mRingCapacity(0),
+    mMemory(std::move(memory)),
+    mThreadConfig(receiveThread){
+    auto header = connection_header(mMemory);
+    mRingCapacity = header->ringCapacity;
+    mConnected.store(true);
+    header->serverPid.store(current_process_id());
+    header->accepted.store(1);
+    futex_wake(header->accepted);
+    startReceiveLoop();
+}
+
+ShmClientSocket::ShmClientSocket(std::string name, std::size_t ringCapacity, ThreadConfig receiveThread):
+    mSide(SocketSide::Client),
+    mName(name),
+    mRingCapacity(ring_capacity(ringCapacity)),
+    mMemory(nullptr, shm_release),
+    mThreadConfig(receiveThread){
+}
+
+ShmClientSocket::~ShmClientSocket(){
+    isReceiving.store(false);
+    if (mMemory){
+        auto header = connection_header(mMemory);
+        (mSide == SocketSide::Server ? header->serverClosed : header->clientClosed).store(1);
+        for (auto ring : {&header->toServer, &header->toClient}){
+            ring->dataSignal.fetch_add(1);
+            futex_wake(ring->dataSignal);
+            ring->spaceSignal.fetch_add(1);
+            futex_wake(ring->spaceSignal);
+        }
+    }
+    try{
+        if (receiveThread.joinable())
+            receiveThread.join();
+    }
+    catch (std::system_error &){
+        assert(false);
+    }
+    if (!mConnectionName.empty())
+        shm_remove(mConnectionName);
+}
+
+bool ShmClientSocket::connectRemote(){
+    if (mSide == SocketSide::Server || mName.empty())
+        throw std::runtime_error("Socket is not connactable");
+
+    if (mConnected.load())
+        return true;
+
+    auto listenMemory = shm_attach(mName);
+    if (!listenMemory || listenMemory->size < sizeof(ShmListenHeader))
+        return false;
+
+    auto listenHeader = reinterpret_cast<ShmListenHeader *>(listenMemory->address);
+    if (listenHeader->magic.load() != SHM_LISTEN_MAGIC || !listener_alive(listenHeader))
+        return false;
+
+    auto connectionId = listenHeader->nextConnectionId.fetch_add(1);
+    mConnectionName = mName + "_" + std::to_string(connectionId);
+    shm_remove(mConnectionName);
+    mMemory = shm_create(mConnectionName, SHM_CONNECTION_HEADER_LEN + 2 * mRingCapacity);
+    if (!mMemory)
+        return false;
+
+    auto header = new (mMemory->address) ShmConnectionHeader();
+    header->accepted.store(0);
+    header->serverClosed.store(0);
+    header->clientClosed.store(0);
+    header->serverPid.store(0);
+    header->clientPid.store(current_process_id());
+    header->ringCapacity = mRingCapacity;
+    for (auto ring : {&header->toServer, &header->toClient}){
+        ring->head.store(0);
+        ring->tail.store(0);
+        ring->dataSignal.store(0);
+        ring->consumerWaiting.store(0);
+        ring->spaceSignal.store(0);
+        ring->producerWaiting.store(0);
+    }
+    header->magic.store(SHM_CONNECTION_MAGIC);
+
+    auto &slot = listenHeader->slots[connectionId % SHM_ACCEPT_BACKLOG];
+    auto deadline = std::chrono::steady_clock::now() + SHM_CONNECT_TIMEOUT;
+    std::uint32_t emptySlot = 0;
+    while (!slot.compare_exchange_weak(emptySlot, connectionId + 1)){
+        emptySlot = 0;
+        if (!listener_alive(listenHeader) || std::chrono::steady_clock::now() > deadline){
+            mMemory.reset();
+            shm_remove(mConnectionName);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    listenHeader->requestSignal.fetch_add(1);
+    futex_wake(listenHeader->requestSignal);
+
+    while (header->accepted.load() == 0){
+        auto now = std::chrono::steady_clock::now();
+        if (!listener_alive(listenHeader) || now > deadline){
+            auto request = connectionId + 1;
+            slot.compare_exchange_strong(request, 0);
+            header->clientClosed.store(1);
+            for (auto ring : {&header->toServer, &header->toClient}){
+                ring->dataSignal.fetch_add(1);
+                futex_wake(ring->dataSignal);
+            }
+            mMemory.reset();
+            shm_remove(mConnectionName);
+            return false;
+        }
+        futex_wait(header->accepted, 0, std::min(SHM_WAIT_TIMEOUT,
+                   std::chrono::duration_cast<std::chrono::microseconds>(deadline - now)));
+    }
+
+    mConnected.store(true);
+    startReceiveLoop();
+    return true;
+}
+
+void ShmClientSocket::send(const ByteBuffer &data){
+    send(data.data(), data.size());
+}
+
+void ShmClientSocket::send(const Byte *data, std::size_t length){
+    if (!mConnected.load())
+        throw std::runtime_error("Socket is in invalid state");
+
+    auto recordLength = (SHM_RECORD_HEADER_LEN + length + 7) & ~std::size_t(7);
+    if (recordLength > mRingCapacity / 2)
+        throw std::runtime_error("Message is too large for shared memory ring");
+
+    std::lock_guard<std::mutex> lock(mSendMutex);
+    auto header = connection_header(mMemory);
+    auto &ring = send_ring(header, mSide);
+    auto ringData = send_data(mMemory, mSide);
+
+    auto head = ring.head.load(std::memory_order_relaxed);
+    auto position = head & (mRingCapacity - 1);
+    auto contiguous = mRingCapacity - position;
+    auto required = recordLength <= contiguous ? recordLength : contiguous + recordLength;
+    auto peerLost = false;
+    while (mRingCapacity - (head - ring.tail.load()) < required){
+        if (peer_closed(header, mSide) || peerLost || !isReceiving.load())
+            throw std::runtime_error("Send error. Shared memory peer disconnected");
+        ring.producerWaiting.store(1);
+        auto spaceSignal = ring.spaceSignal.load();
+        if (mRingCapacity - (head - ring.tail.load()) < required)
+            peerLost = !futex_wait(ring.spaceSignal, spaceSignal, SHM_WAIT_TIMEOUT) && !peer_alive(header, mSide);
+        ring.producerWaiting.store(0);
+    }
+
+    if (recordLength > contiguous){
+        std::memcpy(ringData + position, &SHM_WRAP_MARKER, sizeof(SHM_WRAP_MARKER));
+        head += contiguous;
+        position = 0;
+    }
+    auto messageLength = static_cast<std::uint32_t>(length);
+    std::memcpy(ringData + position, &messageLength, sizeof(messageLength));
+    std::memcpy(ringData + position + SHM_RECORD_HEADER_LEN, data, length);
+    ring.head.store(head + recordLength);
+    signal(ring.dataSignal, ring.consumerWaiting);
+}
+
+void ShmClientSocket::setDataReceivedCallback(std::function<void (ByteBuffer)> callback){
+    dataReceivedCallback = callback;
+}
+
+void ShmClientSocket::setDataViewCallback(std::function<void (const Byte *, std::size_t)> callback){
+    dataViewCallback = callback;
+}
+
+void ShmClientSocket::setDisconnectedCallback(std::function<void ()> callback){
+    disconnectedCallback = callback;
+}
+
+void ShmClientSocket::startReceiveLoop(){
+    receiveThread = std::thread([=](){
+        apply_thread_config(IoThreadRole::ShmReceive, mThreadConfig);
+        auto header = connection_header(mMemory);
+        auto &ring = receive_ring(header, mSide);
+        auto ringData = receive_data(mMemory, mSide);
+        auto tail = ring.tail.load(std::memory_order_relaxed);
+        auto peerLost = false;
+        while(isReceiving.load()){
+            if (ring.head.load() == tail){
+                if (peer_closed(header, mSide) || peerLost){
+                    mConnected.store(false);
+                    if (disconnectedCallback) disconnectedCallback();
+                    return;
+                }
+                ring.consumerWaiting.store(1);
+                auto dataSignal = ring.dataSignal.load();
+                if (ring.head.load() == tail && !peer_closed(header, mSide))
+                    peerLost = !futex_wait(ring.dataSignal, dataSignal, SHM_WAIT_TIMEOUT) && !peer_alive(header, mSide);
+                ring.consumerWaiting.store(0);
+                continue;
+            }
+
+            auto position = tail & (mRingCapacity - 1);
+            std::uint32_t messageLength;
+            std::memcpy(&messageLength, ringData + position, sizeof(messageLength));
+            if (messageLength == SHM_WRAP_MARKER){
+                tail += mRingCapacity - position;
+                continue;
+            }
+
+            auto payload = ringData + position + SHM_RECORD_HEADER_LEN;
+            if (dataViewCallback) dataViewCallback(payload, messageLength);
+            if (dataReceivedCallback) dataReceivedCallback(ByteBuffer(payload, payload + messageLength));
+
+            tail += (SHM_RECORD_HEADER_LEN + messageLength + 7) & ~std::uint64_t(7);
+            ring.tail.store(tail);
+            signal(ring.spaceSignal, ring.producerWaiting);
+        }
+    });
+}
+
+}
+
+#endif
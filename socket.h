@@ -2,8 +2,13 @@
 #define BASE_SOCKET_H
 
 #include "net_types.h"
+#include "net_stats.h"
+#include "flow_control.h"
+#include "pacing.h"
+#include "thread_config.h"
 #include <functional>
 #include <atomic>
+#include <mutex>
 #include <thread>
 
 #if defined(WIN_OS)
@@ -13,6 +18,8 @@
 #include "windows/win_socket.h"
 #elif  defined(POSIX_OS)
 #include "posix/posix_socket.h"
+#include "posix/posix_shm.h"
+#include "traffic_capture.h"
 #endif
 
 namespace Net
@@ -31,36 +38,92 @@ protected:
     BaseSocket(socket_t &&);
 };
 
+struct ConnectionRegistry;
+
 class TcpClientSocket : public BaseSocket{
 public:
-    TcpClientSocket(socket_t &&);
-    TcpClientSocket(std::string address, PortNumberType port);
+    TcpClientSocket(socket_t &&, ThreadConfig receiveThread = get_thread_config(IoThreadRole::TcpReceive));
+    TcpClientSocket(std::string address, PortNumberType port, ThreadConfig receiveThread = get_thread_config(IoThreadRole::TcpReceive));
     ~TcpClientSocket();
     bool connectRemote();
     void send(const ByteBuffer &);
+    bool enableKernelTimestamps();
     void setDataReceivedCallback(std::function<void(ByteBuffer)>);
+    void setTimestampedDataReceivedCallback(std::function<void(ByteBuffer, TimePoint)>);
     void setDisconnectedCallback(std::function<void()>);
+    ReceiveLatency receiveLatency() const;
+    void setRateLimiter(std::shared_ptr<TokenBucket>);
+    bool setMaxPacingRate(std::uint64_t bytesPerSecond);
+    DurationStatistics pacingDelay() const;
+    void setSendQueueCapacity(std::size_t);
+    SendQueueStatistics sendQueueStatistics() const;
+    void setSendErrorCallback(std::function<void(std::string)>);
+    void pauseReading();
+    void resumeReading();
+    bool isReadingPaused() const;
+    void setReceiveBudget(std::size_t highWatermark, std::size_t lowWatermark);
+    void releaseReceivedBytes(std::size_t);
+#if defined(POSIX_OS)
+    void setCapture(std::shared_ptr<CaptureWriter>, std::uint32_t connectionId);
+#endif
 
 private:
-    bool mConnected{false};
+    std::atomic<bool> mConnected{false};
     std::function<void(ByteBuffer)> dataReceivedCallback;
+    std::function<void(ByteBuffer, TimePoint)> timestampedDataReceivedCallback;
     std::function<void()> disconnectedCallback;
     addr_info_ptr mAddressInfo;
+    std::atomic<bool> mKernelTimestamps{false};
+    DurationRecorder mArrivalToDispatch;
+    DurationRecorder mCallbackDuration;
+    std::function<void(std::string)> sendErrorCallback;
+    std::size_t mSendQueueCapacity{0};
+    std::atomic<bool> mSendFailed{false};
+    std::mutex mSendMutex;
+    std::unique_ptr<SendQueue> mSendQueue;
+    std::unique_ptr<SendQueue> mBroadcastQueue;
+    std::shared_ptr<ConnectionRegistry> mRegistry;
+    std::atomic<bool> mEvicted{false};
+    ReceiveFlowControl mFlowControl;
+#if defined(POSIX_OS)
+    std::shared_ptr<const CaptureBinding> mCapture;
+#endif
+    ThreadConfig mThreadConfig;
     std::atomic<bool> isReceiving{true};
     std::thread receiveThread;
 
     void startReceiveLoop();
+    std::unique_ptr<SendQueue> createSendQueue(std::shared_ptr<TokenBucket>, std::size_t capacity);
+    bool sendLocked(const ByteBuffer &);
+    bool enqueueBroadcast(const std::shared_ptr<const ByteBuffer> &, SlowClientPolicy);
+
+    friend class TcpServerSocket;
 };
 
 class TcpServerSocket : public BaseSocket{
 public:
-    TcpServerSocket(PortNumberType port);
+    TcpServerSocket(PortNumberType port, bool shareAddress = false, ThreadConfig acceptThread = get_thread_config(IoThreadRole::TcpAccept));
     ~TcpServerSocket();
     void startListen();
     void setClientConnectedCallback(std::function<void(std::unique_ptr<TcpClientSocket>)>);
+    void setClientThreadConfig(ThreadConfig receiveThread);
+    // Broadcast frames go through a per-client queue of their own; the
+    // client's send() is not affected.
+    void enableBroadcast(std::size_t maxQueuedFrames, SlowClientPolicy = SlowClientPolicy::DropFrames);
+    std::size_t broadcast(std::shared_ptr<const ByteBuffer>);
+    std::size_t broadcast(const ByteBuffer &);
+    std::size_t connectionCount() const;
+    std::uint64_t droppedFrames() const;
 
 private:
     std::function<void(std::unique_ptr<TcpClientSocket>)> clientConnectedCallback;
+    std::shared_ptr<ConnectionRegistry> mRegistry;
+    std::size_t mMaxQueuedFrames{0};
+    SlowClientPolicy mSlowClientPolicy{SlowClientPolicy::DropFrames};
+    std::atomic<std::uint64_t> mDroppedFrames{0};
+    bool mSharedAddress;
+    ThreadConfig mThreadConfig;
+    ThreadConfig mClientThreadConfig;
     bool listening{false};
     std::atomic<bool> isAccepting{true};
     std::thread acceptLoop;
@@ -70,19 +133,121 @@ private:
 
 class UdpSocket : public BaseSocket{
 public:
-    UdpSocket(PortNumberType port);
+    UdpSocket(PortNumberType port, bool shareAddress = false, ThreadConfig receiveThread = get_thread_config(IoThreadRole::UdpReceive));
     ~UdpSocket();
     bool sendTo(std::string address, PortNumberType port, const ByteBuffer &);
+    bool setDestination(std::string address, PortNumberType port);
+    bool send(const ByteBuffer &);
+    bool joinGroup(std::string group, std::string interfaceAddress = std::string());
+    bool leaveGroup(std::string group, std::string interfaceAddress = std::string());
+    bool joinSourceGroup(std::string group, std::string source, std::string interfaceAddress = std::string());
+    bool leaveSourceGroup(std::string group, std::string source, std::string interfaceAddress = std::string());
+    bool setMulticastInterface(std::string interfaceAddress);
+    bool setMulticastTtl(int ttl);
+    bool setMulticastLoopback(bool enabled);
+    bool enableKernelTimestamps();
     void setDataReceivedCallback(std::function<void(ByteBuffer, std::string, PortNumberType)>);
+    void setTimestampedDataReceivedCallback(std::function<void(ByteBuffer, std::string, PortNumberType, TimePoint)>);
+    ReceiveLatency receiveLatency() const;
+    void setRateLimiter(std::shared_ptr<TokenBucket>);
+    bool setMaxPacingRate(std::uint64_t bytesPerSecond);
+    DurationStatistics pacingDelay() const;
+    void setSendQueueCapacity(std::size_t);
+    SendQueueStatistics sendQueueStatistics() const;
+    void setSendErrorCallback(std::function<void(std::string)>);
+    void pauseReading();
+    void resumeReading();
+    bool isReadingPaused() const;
+    void setReceiveBudget(std::size_t highWatermark, std::size_t lowWatermark);
+    void releaseReceivedBytes(std::size_t);
+#if defined(POSIX_OS)
+    void setCapture(std::shared_ptr<CaptureWriter>, std::uint32_t connectionId);
+#endif
 
 private:
     std::function<void(ByteBuffer, std::string, PortNumberType)> dataReceivedCallback;
+    std::function<void(ByteBuffer, std::string, PortNumberType, TimePoint)> timestampedDataReceivedCallback;
+    bool mSharedAddress;
+    std::shared_ptr<addr_info_ptr> mDestination;
+    std::atomic<bool> mKernelTimestamps{false};
+    DurationRecorder mArrivalToDispatch;
+    DurationRecorder mCallbackDuration;
+    std::function<void(std::string)> sendErrorCallback;
+    std::size_t mSendQueueCapacity{0};
+    std::unique_ptr<SendQueue> mSendQueue;
+    ReceiveFlowControl mFlowControl;
+#if defined(POSIX_OS)
+    std::shared_ptr<const CaptureBinding> mCapture;
+#endif
+    ThreadConfig mThreadConfig;
+    std::atomic<bool> isReceiving{true};
+    std::thread receiveThread;
+
+    void startReceiveLoop();
+    void createSendQueue(std::shared_ptr<TokenBucket>);
+};
+
+#if defined(POSIX_OS)
+
+constexpr std::size_t SHM_DEFAULT_RING_CAPACITY = 16 * 1024 * 1024;
+
+class ShmClientSocket{
+public:
+    ShmClientSocket(shared_memory_ptr &&, ThreadConfig receiveThread = get_thread_config(IoThreadRole::ShmReceive));
+    ShmClientSocket(std::string name, std::size_t ringCapacity = SHM_DEFAULT_RING_CAPACITY, ThreadConfig receiveThread = get_thread_config(IoThreadRole::ShmReceive));
+    ShmClientSocket(const ShmClientSocket &) = delete;
+    ShmClientSocket& operator=(const ShmClientSocket &) = delete;
+    ~ShmClientSocket();
+    bool connectRemote();
+    void send(const ByteBuffer &);
+    void send(const Byte *, std::size_t);
+    void setDataReceivedCallback(std::function<void(ByteBuffer)>);
+    void setDataViewCallback(std::function<void(const Byte *, std::size_t)>);
+    void setDisconnectedCallback(std::function<void()>);
+
+private:
+    SocketSide mSide;
+    std::string mName;
+    std::size_t mRingCapacity;
+    std::string mConnectionName;
+    shared_memory_ptr mMemory;
+    std::atomic<bool> mConnected{false};
+    std::function<void(ByteBuffer)> dataReceivedCallback;
+    std::function<void(const Byte *, std::size_t)> dataViewCallback;
+    std::function<void()> disconnectedCallback;
+    std::mutex mSendMutex;
+    ThreadConfig mThreadConfig;
     std::atomic<bool> isReceiving{true};
     std::thread receiveThread;
 
     void startReceiveLoop();
 };
 
+class ShmServerSocket{
+public:
+    ShmServerSocket(std::string name, ThreadConfig acceptThread = get_thread_config(IoThreadRole::ShmAccept));
+    ShmServerSocket(const ShmServerSocket &) = delete;
+    ShmServerSocket& operator=(const ShmServerSocket &) = delete;
+    ~ShmServerSocket();
+    void startListen();
+    void setClientConnectedCallback(std::function<void(std::unique_ptr<ShmClientSocket>)>);
+    void setClientThreadConfig(ThreadConfig receiveThread);
+
+private:
+    std::string mName;
+    shared_memory_ptr mMemory;
+    std::function<void(std::unique_ptr<ShmClientSocket>)> clientConnectedCallback;
+    ThreadConfig mThreadConfig;
+    ThreadConfig mClientThreadConfig;
+    bool listening{false};
+    std::atomic<bool> isAccepting{true};
+    std::thread acceptLoop;
+
+    void startAcceptLoop();
+};
+
+#endif
+
 }
 
 #endif // BASE_SOCKET_H
@@ -2,11 +2,21 @@
 #include <system_error>
 #include <cassert>
 #include <iostream>
+#include <algorithm>
+#include <vector>
 
 namespace Net
 {
 
-TcpServerSocket::TcpServerSocket(PortNumberType port){
+struct ConnectionRegistry{
+    std::mutex mutex;
+    std::vector<TcpClientSocket *> clients;
+};
+
+TcpServerSocket::TcpServerSocket(PortNumberType port, bool shareAddress, ThreadConfig acceptThread):
+    mSharedAddress(shareAddress),
+    mThreadConfig(acceptThread),
+    mClientThreadConfig(get_thread_config(IoThreadRole::TcpReceive)){
     auto addresInfo = get_addr_info(SocketType::TCP, port);
     if(!addresInfo)
         throw std::runtime_error("Unable to create address info");
@@ -15,6 +25,10 @@ TcpServerSocket::TcpServerSocket(PortNumberType port){
     if (!socket_valid(this->mSocket))
         throw std::runtime_error("Unable to create socket");
 
+    if (shareAddress && !socket_set_reuse_address(this->mSocket)){
+        socket_close(mSocket);
+        throw std::runtime_error("Unable to share socket address");
+    }
 
     if (!socket_bind(this->mSocket, addresInfo)){
         socket_close(mSocket);
@@ -52,13 +66,83 @@ void TcpServerSocket::setClientConnectedCallback(std::function<void(std::unique_
     clientConnectedCallback = callback;
 }
 
+void TcpServerSocket::setClientThreadConfig(ThreadConfig receiveThread){
+    if (listening)
+        throw std::runtime_error("Client thread config must be set before listening");
+
+    mClientThreadConfig = receiveThread;
+}
+
+void TcpServerSocket::enableBroadcast(std::size_t maxQueuedFrames, SlowClientPolicy policy){
+    if (listening)
+        throw std::runtime_error("Broadcast must be enabled before listening");
+    if (maxQueuedFrames == 0)
+        throw std::runtime_error("Broadcast queue limit must be positive");
+
+    mRegistry = std::make_shared<ConnectionRegistry>();
+    mMaxQueuedFrames = maxQueuedFrames;
+    mSlowClientPolicy = policy;
+}
+
+std::size_t TcpServerSocket::broadcast(std::shared_ptr<const ByteBuffer> data){
+    if (!mRegistry)
+        throw std::runtime_error("Broadcast is not enabled");
+
+    std::size_t queued = 0;
+    std::lock_guard<std::mutex> lock(mRegistry->mutex);
+    auto &clients = mRegistry->clients;
+    for (auto client = clients.begin(); client != clients.end();){
+        if ((*client)->mEvicted.load()){
+            client = clients.erase(client);
+            continue;
+        }
+        if ((*client)->enqueueBroadcast(data, mSlowClientPolicy))
+            ++queued;
+        else
+            mDroppedFrames.fetch_add(1);
+        if ((*client)->mEvicted.load())
+            client = clients.erase(client);
+        else
+            ++client;
+    }
+    return queued;
+}
+
+std::size_t TcpServerSocket::broadcast(const ByteBuffer &data){
+    return broadcast(std::make_shared<const ByteBuffer>(data));
+}
+
+std::size_t TcpServerSocket::connectionCount() const{
+    if (!mRegistry)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(mRegistry->mutex);
+    return static_cast<std::size_t>(std::count_if(mRegistry->clients.begin(), mRegistry->clients.end(), [](TcpClientSocket *client){
+        return !client->mEvicted.load();
+    }));
+}
+
+std::uint64_t TcpServerSocket::droppedFrames() const{
+    return mDroppedFrames.load();
+}
+
 void TcpServerSocket::startAcceptLoop(){
     acceptLoop = std::thread([=](){
+        if (mSharedAddress)
+            apply_thread_config(IoThreadRole::TcpAccept, mThreadConfig, mSocket);
+        else
+            apply_thread_config(IoThreadRole::TcpAccept, mThreadConfig);
         while(isAccepting.load()){
             auto client = socket_accept(mSocket);
             if (socket_valid(client)){
                 try{
-                    std::unique_ptr<TcpClientSocket> acceptedClient(new TcpClientSocket(std::move(client)));
+                    std::unique_ptr<TcpClientSocket> acceptedClient(new TcpClientSocket(std::move(client), mClientThreadConfig));
+                    if (mRegistry){
+                        acceptedClient->mBroadcastQueue = acceptedClient->createSendQueue(nullptr, mMaxQueuedFrames);
+                        acceptedClient->mRegistry = mRegistry;
+                        std::lock_guard<std::mutex> lock(mRegistry->mutex);
+                        mRegistry->clients.push_back(acceptedClient.get());
+                    }
                     if (clientConnectedCallback) clientConnectedCallback(std::move(acceptedClient));
                 }
                 catch (std::runtime_error &e){
@@ -70,15 +154,17 @@ void TcpServerSocket::startAcceptLoop(){
     });
 }
 
-TcpClientSocket::TcpClientSocket(socket_t &&soc):
+TcpClientSocket::TcpClientSocket(socket_t &&soc, ThreadConfig receiveThread):
     BaseSocket(std::move(soc)),
-    mAddressInfo(get_addr_info(SocketType::TCP, 0)){
+    mAddressInfo(get_addr_info(SocketType::TCP, 0)),
+    mThreadConfig(receiveThread){
     mConnected = true;
     startReceiveLoop();
 }
 
-TcpClientSocket::TcpClientSocket(std::string address, PortNumberType port):
-    mAddressInfo(get_addr_info(SocketType::TCP, port, address)){
+TcpClientSocket::TcpClientSocket(std::string address, PortNumberType port, ThreadConfig receiveThread):
+    mAddressInfo(get_addr_info(SocketType::TCP, port, address)),
+    mThreadConfig(receiveThread){
 
     if(!mAddressInfo)
         throw std::runtime_error("Unable to create address info");
@@ -91,9 +177,24 @@ TcpClientSocket::TcpClientSocket(std::string address, PortNumberType port):
 }
 
 TcpClientSocket::~TcpClientSocket(){
+    if (mRegistry){
+        std::lock_guard<std::mutex> lock(mRegistry->mutex);
+        auto &clients = mRegistry->clients;
+        clients.erase(std::remove(clients.begin(), clients.end(), this), clients.end());
+    }
+    // Queued sends get a bounded time to drain while pending broadcast frames
+    // are dropped. The socket is shut down before the send threads are joined
+    // so a send blocked on a stalled peer returns instead of hanging the
+    // destructor.
+    mEvicted.store(true);
+    if (mSendQueue)
+        mSendQueue->close(SEND_QUEUE_DRAIN_TIMEOUT);
     try{
         isReceiving.store(false);
+        mFlowControl.wake();
         socket_shutdown(mSocket);
+        mBroadcastQueue.reset();
+        mSendQueue.reset();
         if (receiveThread.joinable()){
             try{
                 receiveThread.join();
@@ -116,26 +217,172 @@ bool TcpClientSocket::connectRemote(){
     if (!socket_valid(mSocket))
         throw std::runtime_error("Socket is in invalid state");
 
-    return mConnected = socket_connect(this->mSocket, mAddressInfo);
+    mConnected = socket_connect(this->mSocket, mAddressInfo);
+#if defined(POSIX_OS)
+    auto capture = std::atomic_load(&mCapture);
+    if (mConnected && capture){
+        auto binding = std::make_shared<CaptureBinding>(*capture);
+        get_peer_endpoint(mSocket, binding->peerAddress, binding->peerPort);
+        std::atomic_store(&mCapture, std::shared_ptr<const CaptureBinding>(binding));
+    }
+#endif
+    return mConnected;
 }
 
 void TcpClientSocket::send(const ByteBuffer &data){
     if (!socket_valid(mSocket))
         throw std::runtime_error("Socket is in invalid state");
-    if (!socket_send(this->mSocket, data))
+    if (mSendFailed.load())
+        throw std::runtime_error("Send error. A queued send has failed");
+    if (mSendQueue){
+        auto queued = mSendQueue->enqueue(data.size(), [this, data](){
+            if (mSendFailed.load())
+                return;
+            if (!sendLocked(data)){
+                mSendFailed.store(true);
+                throw std::runtime_error(std::string("Send error. Error code: ") + std::to_string(get_last_error()));
+            }
+        });
+        if (!queued)
+            throw std::runtime_error("Send error. Send queue is full");
+        return;
+    }
+    if (!sendLocked(data))
         throw std::runtime_error(std::string("Send error. Error code: ") + std::to_string(get_last_error()));
 }
 
+bool TcpClientSocket::sendLocked(const ByteBuffer &data){
+    std::lock_guard<std::mutex> lock(mSendMutex);
+    return socket_send(mSocket, data);
+}
+
+bool TcpClientSocket::enqueueBroadcast(const std::shared_ptr<const ByteBuffer> &data, SlowClientPolicy policy){
+    if (mEvicted.load())
+        return false;
+
+    auto queued = mBroadcastQueue->enqueue(data->size(), [this, data](){
+        if (mEvicted.load())
+            return;
+        if (!sendLocked(*data)){
+            mEvicted.store(true);
+            throw std::runtime_error(std::string("Broadcast send error. Error code: ") + std::to_string(get_last_error()));
+        }
+    });
+    if (!queued && policy == SlowClientPolicy::Disconnect){
+        mEvicted.store(true);
+        socket_shutdown(mSocket);
+    }
+    return queued;
+}
+
+void TcpClientSocket::setRateLimiter(std::shared_ptr<TokenBucket> rateLimiter){
+    if (!mSendQueue)
+        mSendQueue = createSendQueue(rateLimiter, mSendQueueCapacity);
+    else
+        mSendQueue->setRateLimiter(rateLimiter);
+    if (mBroadcastQueue)
+        mBroadcastQueue->setRateLimiter(rateLimiter);
+}
+
+void TcpClientSocket::setSendQueueCapacity(std::size_t capacity){
+    mSendQueueCapacity = capacity;
+    if (mSendQueue)
+        mSendQueue->setCapacity(capacity);
+}
+
+SendQueueStatistics TcpClientSocket::sendQueueStatistics() const{
+    if (!mSendQueue)
+        return SendQueueStatistics{0, 0, 0, 0, 0};
+    return mSendQueue->statistics();
+}
+
+void TcpClientSocket::setSendErrorCallback(std::function<void (std::string)> callback){
+    sendErrorCallback = callback;
+}
+
+std::unique_ptr<SendQueue> TcpClientSocket::createSendQueue(std::shared_ptr<TokenBucket> rateLimiter, std::size_t capacity){
+    std::unique_ptr<SendQueue> queue(new SendQueue(rateLimiter, capacity));
+    queue->setErrorCallback([this](const std::string &error){
+        if (sendErrorCallback)
+            sendErrorCallback(error);
+        else
+            std::cerr<< "Failed to send queued data: " << error <<std::endl;
+    });
+    return queue;
+}
+
+bool TcpClientSocket::setMaxPacingRate(std::uint64_t bytesPerSecond){
+    if (!socket_valid(mSocket))
+        throw std::runtime_error("Socket is in invalid state");
+    return socket_set_max_pacing_rate(mSocket, bytesPerSecond);
+}
+
+DurationStatistics TcpClientSocket::pacingDelay() const{
+    if (!mSendQueue)
+        return DurationRecorder().statistics();
+    return mSendQueue->queueDelay();
+}
+
+bool TcpClientSocket::enableKernelTimestamps(){
+    if (!socket_valid(mSocket))
+        throw std::runtime_error("Socket is in invalid state");
+    if (!socket_enable_timestamps(mSocket))
+        return false;
+    mKernelTimestamps.store(true);
+    return true;
+}
+
 void TcpClientSocket::setDataReceivedCallback(std::function<void (ByteBuffer)> callback){
     dataReceivedCallback = callback;
 }
 
+void TcpClientSocket::setTimestampedDataReceivedCallback(std::function<void (ByteBuffer, TimePoint)> callback){
+    timestampedDataReceivedCallback = callback;
+}
+
 void TcpClientSocket::setDisconnectedCallback(std::function<void ()> callback){
     disconnectedCallback = callback;
 }
 
+ReceiveLatency TcpClientSocket::receiveLatency() const{
+    return ReceiveLatency{mArrivalToDispatch.statistics(), mCallbackDuration.statistics()};
+}
+
+void TcpClientSocket::pauseReading(){
+    mFlowControl.pause();
+}
+
+void TcpClientSocket::resumeReading(){
+    mFlowControl.resume();
+}
+
+bool TcpClientSocket::isReadingPaused() const{
+    return mFlowControl.paused();
+}
+
+void TcpClientSocket::setReceiveBudget(std::size_t highWatermark, std::size_t lowWatermark){
+    mFlowControl.setWatermarks(highWatermark, lowWatermark);
+}
+
+void TcpClientSocket::releaseReceivedBytes(std::size_t bytes){
+    mFlowControl.consumed(bytes);
+}
+
+#if defined(POSIX_OS)
+void TcpClientSocket::setCapture(std::shared_ptr<CaptureWriter> capture, std::uint32_t connectionId){
+    std::shared_ptr<const CaptureBinding> binding;
+    if (capture){
+        auto newBinding = std::make_shared<CaptureBinding>(CaptureBinding{capture, connectionId, std::string(), 0});
+        get_peer_endpoint(mSocket, newBinding->peerAddress, newBinding->peerPort);
+        binding = newBinding;
+    }
+    std::atomic_store(&mCapture, binding);
+}
+#endif
+
 void TcpClientSocket::startReceiveLoop(){
     receiveThread = std::thread([=](){
+        apply_thread_config(IoThreadRole::TcpReceive, mThreadConfig);
         while(isReceiving.load()){
             if (!socket_valid(mSocket)){
                 if (disconnectedCallback) disconnectedCallback();
@@ -145,13 +392,32 @@ void TcpClientSocket::startReceiveLoop(){
                 std::this_thread::sleep_for(std::chrono::microseconds(1));
                 continue;
             }
+            if (!mFlowControl.waitUntilReadable(FLOW_CONTROL_POLL_INTERVAL)){
+                if (isReceiving.load() && socket_connection_lost(mSocket)){
+                    if (disconnectedCallback) disconnectedCallback();
+                    return;
+                }
+                continue;
+            }
             try{
-                auto data = socket_receive(mSocket);
+                TimePoint arrivalTime;
+                auto data = socket_receive(mSocket, arrivalTime);
                 if(data.size()==0){
                     if (disconnectedCallback) disconnectedCallback();
                     return;
                 }
+                if (mKernelTimestamps.load())
+                    mArrivalToDispatch.record(std::chrono::system_clock::now() - arrivalTime);
+#if defined(POSIX_OS)
+                auto capture = std::atomic_load(&mCapture);
+                if (capture)
+                    capture->writer->record(CaptureSource::TCP, capture->connectionId, arrivalTime, capture->peerAddress, capture->peerPort, data);
+#endif
+                mFlowControl.delivered(data.size());
+                auto callbackStart = std::chrono::steady_clock::now();
+                if (timestampedDataReceivedCallback) timestampedDataReceivedCallback(data, arrivalTime);
                 if (dataReceivedCallback) dataReceivedCallback(data);
+                mCallbackDuration.record(std::chrono::steady_clock::now() - callbackStart);
             }
             catch (std::runtime_error &e){
                 std::cerr<< "Failed to recive data: " << e.what() <<std::endl;
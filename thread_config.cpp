@@ -0,0 +1,90 @@
+#include "thread_config.h"
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <mutex>
+
+#if defined(WIN_OS)
+#include "windows/win_thread.h"
+#elif  defined(POSIX_OS)
+#include "posix/posix_thread.h"
+#endif
+
+namespace Net
+{
+
+namespace
+{
+
+std::mutex configMutex;
+std::map<IoThreadRole, ThreadConfig> configs;
+
+std::string default_thread_name(IoThreadRole role);
+
+void apply(IoThreadRole role, const ThreadConfig &config){
+    thread_set_name(config.name.empty() ? default_thread_name(role) : config.name);
+    // Pinning happens before the thread allocates its buffers, so first-touch
+    // places them on the memory node of the configured cpus.
+    if (!config.cpus.empty() && !thread_set_affinity(config.cpus))
+        std::cerr<< "Failed to set affinity of thread " << config.name <<std::endl;
+    if (config.fifoPriority > 0 && !thread_set_fifo_priority(config.fifoPriority))
+        std::cerr<< "Failed to set priority of thread " << config.name <<std::endl;
+}
+
+std::string default_thread_name(IoThreadRole role){
+    switch (role){
+    case IoThreadRole::TcpAccept: return "net-tcp-accept";
+    case IoThreadRole::TcpReceive: return "net-tcp-recv";
+    case IoThreadRole::UdpReceive: return "net-udp-recv";
+    case IoThreadRole::ShmAccept: return "net-shm-accept";
+    case IoThreadRole::ShmReceive: return "net-shm-recv";
+    case IoThreadRole::Send: return "net-send";
+    case IoThreadRole::Timer: return "net-timer";
+    }
+    return "net-io";
+}
+
+}
+
+void set_thread_config(IoThreadRole role, ThreadConfig config){
+    if (config.fifoPriority < 0)
+        throw std::runtime_error("Thread priority must not be negative");
+    for (auto cpu : config.cpus)
+        if (cpu < 0)
+            throw std::runtime_error("Invalid cpu index");
+
+    std::lock_guard<std::mutex> lock(configMutex);
+    configs[role] = std::move(config);
+}
+
+ThreadConfig get_thread_config(IoThreadRole role){
+    std::lock_guard<std::mutex> lock(configMutex);
+    auto config = configs.find(role);
+    if (config == configs.end())
+        return ThreadConfig{default_thread_name(role), {}, 0, false};
+    auto result = config->second;
+    if (result.name.empty())
+        result.name = default_thread_name(role);
+    return result;
+}
+
+void reset_thread_config(){
+    std::lock_guard<std::mutex> lock(configMutex);
+    configs.clear();
+}
+
+void apply_thread_config(IoThreadRole role, const ThreadConfig &config){
+    apply(role, config);
+}
+
+void apply_thread_config(IoThreadRole role, const ThreadConfig &config, socket_t &socket){
+    apply(role, config);
+    // The kernel overwrites the incoming cpu of a connected socket on every
+    // packet, so only listeners and SO_REUSEPORT groups honour the setting.
+    if (role != IoThreadRole::TcpAccept && role != IoThreadRole::UdpReceive)
+        return;
+    if (config.bindSocketToCpu && !config.cpus.empty() && socket_valid(socket) && !socket_set_incoming_cpu(socket, config.cpus.front()))
+        std::cerr<< "Failed to bind socket of thread " << config.name << " to cpu " << config.cpus.front() <<std::endl;
+}
+
+}
@@ -0,0 +1,53 @@
+#ifndef THREAD_CONFIG_H
+#define THREAD_CONFIG_H
+
+#include "net_types.h"
+#include <string>
+#include <vector>
+
+#if defined(WIN_OS)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include "windows/win_socket.h"
+#elif  defined(POSIX_OS)
+#include "posix/posix_socket.h"
+#endif
+
+namespace Net
+{
+
+enum class IoThreadRole{
+    TcpAccept,
+    TcpReceive,
+    UdpReceive,
+    ShmAccept,
+    ShmReceive,
+    Send,
+    Timer
+};
+
+// An empty name selects the library default, an empty cpu set leaves the
+// affinity untouched and a zero priority keeps the default scheduling policy.
+// bindSocketToCpu steers TCP listeners and UDP sockets created with
+// shareAddress, which form SO_REUSEPORT groups, to the first cpu of the set;
+// it has no effect on sockets that do not share their address.
+// Sockets take a snapshot of the role's config when they are constructed, or
+// use the config passed to their constructor.
+struct ThreadConfig{
+    std::string name;
+    std::vector<int> cpus;
+    int fifoPriority;
+    bool bindSocketToCpu;
+};
+
+void set_thread_config(IoThreadRole, ThreadConfig);
+ThreadConfig get_thread_config(IoThreadRole);
+void reset_thread_config();
+
+void apply_thread_config(IoThreadRole, const ThreadConfig &);
+void apply_thread_config(IoThreadRole, const ThreadConfig &, socket_t &sharedSocket);
+
+}
+
+#endif // THREAD_CONFIG_H
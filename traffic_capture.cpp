@@ -0,0 +1,281 @@
+#include "traffic_capture.h"
+
+#if defined(POSIX_OS)
+#include "socket.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+namespace Net
+{
+
+namespace
+{
+
+constexpr std::uint64_t CAPTURE_MAGIC = 0x3147454d5343454eULL;
+constexpr std::uint64_t CAPTURE_VERSION = 1;
+constexpr std::size_t CAPTURE_SEGMENT_HEADER_LEN = 16;
+constexpr std::size_t CAPTURE_RECORD_HEADER_LEN = 24;
+constexpr std::chrono::milliseconds CAPTURE_PREPARE_RETRY_INTERVAL{100};
+
+std::string segment_path(const std::string &basePath, std::size_t index){
+    return basePath + "." + std::to_string(index);
+}
+
+std::size_t record_length(std::size_t addressLength, std::size_t payloadLength){
+    return (CAPTURE_RECORD_HEADER_LEN + addressLength + payloadLength + 7) & ~std::size_t(7);
+}
+
+}
+
+CaptureWriter::CaptureWriter(std::string basePath, std::size_t segmentSize):
+    mBasePath(basePath),
+    mSegmentSize(std::max(segmentSize, CAPTURE_SEGMENT_HEADER_LEN + CAPTURE_RECORD_HEADER_LEN)),
+    mSegment(nullptr, shm_release),
+    mSpareSegment(nullptr, shm_release),
+    mRetiredSegment(nullptr, shm_release){
+    for (std::size_t index = 0; std::remove(segment_path(mBasePath, index).c_str()) == 0; ++index);
+    mSegment = createSegment(0);
+    if (!mSegment)
+        throw std::runtime_error("Unable to create capture segment");
+    mOffset = CAPTURE_SEGMENT_HEADER_LEN;
+    startPrepareLoop();
+}
+
+CaptureWriter::~CaptureWriter(){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopped = true;
+    }
+    mPrepareCondition.notify_all();
+    try{
+        if (mPrepareThread.joinable())
+            mPrepareThread.join();
+    }
+    catch (std::system_error &){
+        assert(false);
+    }
+    if (mSpareSegment){
+        mSpareSegment.reset();
+        std::remove(segment_path(mBasePath, mSegmentIndex + 1).c_str());
+    }
+}
+
+void CaptureWriter::record(CaptureSource source, std::uint32_t connectionId, TimePoint timestamp, const std::string &address, PortNumberType port, const ByteBuffer &data) noexcept{
+    auto addressLength = std::min<std::size_t>(address.size(), 255);
+    auto length = record_length(addressLength, data.size());
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mOffset + length > mSegment->size){
+        if (!mSpareSegment || CAPTURE_SEGMENT_HEADER_LEN + length > mSpareSegment->size){
+            ++mFailedRecords;
+            return;
+        }
+        mRetiredSegment = std::move(mSegment);
+        mSegment = std::move(mSpareSegment);
+        ++mSegmentIndex;
+        mOffset = CAPTURE_SEGMENT_HEADER_LEN;
+        mPrepareCondition.notify_one();
+    }
+
+    auto recordStart = reinterpret_cast<Byte *>(mSegment->address) + mOffset;
+    auto timestampNs = static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count());
+    auto payloadLength = static_cast<std::uint32_t>(data.size());
+    std::memcpy(recordStart + 4, &connectionId, sizeof(connectionId));
+    std::memcpy(recordStart + 8, &timestampNs, sizeof(timestampNs));
+    std::memcpy(recordStart + 16, &payloadLength, sizeof(payloadLength));
+    std::memcpy(recordStart + 20, &port, sizeof(port));
+    recordStart[22] = static_cast<Byte>(source);
+    recordStart[23] = static_cast<Byte>(addressLength);
+    std::memcpy(recordStart + CAPTURE_RECORD_HEADER_LEN, address.data(), addressLength);
+    std::memcpy(recordStart + CAPTURE_RECORD_HEADER_LEN + addressLength, data.data(), data.size());
+
+    // The length is published last with release ordering; a reader that
+    // acquires a non-zero length sees the complete record.
+    __atomic_store_n(reinterpret_cast<std::uint32_t *>(recordStart), static_cast<std::uint32_t>(length), __ATOMIC_RELEASE);
+    mOffset += length;
+}
+
+std::size_t CaptureWriter::segmentCount() const{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSegmentIndex + 1;
+}
+
+std::uint64_t CaptureWriter::failedRecords() const{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFailedRecords;
+}
+
+shared_memory_ptr CaptureWriter::createSegment(std::size_t index){
+    auto segment = file_map_create(segment_path(mBasePath, index), mSegmentSize);
+    if (!segment)
+        return segment;
+
+    std::memcpy(segment->address, &CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    std::memcpy(reinterpret_cast<Byte *>(segment->address) + 8, &CAPTURE_VERSION, sizeof(CAPTURE_VERSION));
+    return segment;
+}
+
+void CaptureWriter::startPrepareLoop(){
+    mPrepareThread = std::thread([=](){
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mStopped){
+            auto retired = std::move(mRetiredSegment);
+            if (mSpareSegment){
+                lock.unlock();
+                retired.reset();
+                lock.lock();
+                if (!mRetiredSegment && mSpareSegment && !mStopped)
+                    mPrepareCondition.wait(lock);
+                continue;
+            }
+            auto index = mSegmentIndex + 1;
+            lock.unlock();
+            retired.reset();
+            auto segment = createSegment(index);
+            lock.lock();
+            if (segment && index == mSegmentIndex + 1)
+                mSpareSegment = std::move(segment);
+            else if (!mStopped)
+                mPrepareCondition.wait_for(lock, CAPTURE_PREPARE_RETRY_INTERVAL);
+        }
+    });
+}
+
+CaptureReader::CaptureReader(std::string basePath):
+    mBasePath(basePath),
+    mSegment(nullptr, shm_release){
+    if (!openSegment())
+        throw std::runtime_error("Unable to open capture segment");
+}
+
+bool CaptureReader::next(CaptureRecord &record){
+    while (true){
+        auto segmentStart = reinterpret_cast<const Byte *>(mSegment->address);
+        std::uint32_t length = 0;
+        if (mOffset + CAPTURE_RECORD_HEADER_LEN <= mSegment->size)
+            length = __atomic_load_n(reinterpret_cast<const std::uint32_t *>(segmentStart + mOffset), __ATOMIC_ACQUIRE);
+
+        if (length == 0 || mOffset + length > mSegment->size){
+            ++mSegmentIndex;
+            if (openSegment())
+                continue;
+            --mSegmentIndex;
+            return false;
+        }
+
+        auto recordStart = segmentStart + mOffset;
+        std::int64_t timestampNs;
+        std::uint32_t payloadLength;
+        std::memcpy(&record.connectionId, recordStart + 4, sizeof(record.connectionId));
+        std::memcpy(&timestampNs, recordStart + 8, sizeof(timestampNs));
+        std::memcpy(&payloadLength, recordStart + 16, sizeof(payloadLength));
+        std::memcpy(&record.port, recordStart + 20, sizeof(record.port));
+        record.source = static_cast<CaptureSource>(recordStart[22]);
+        auto addressLength = recordStart[23];
+        if (record_length(addressLength, payloadLength) != length)
+            throw std::runtime_error("Capture segment is corrupted");
+
+        record.timestamp = TimePoint(std::chrono::duration_cast<TimePoint::duration>(std::chrono::nanoseconds(timestampNs)));
+        auto address = reinterpret_cast<const char *>(recordStart + CAPTURE_RECORD_HEADER_LEN);
+        record.address.assign(address, addressLength);
+        auto payload = recordStart + CAPTURE_RECORD_HEADER_LEN + addressLength;
+        record.data.assign(payload, payload + payloadLength);
+        mOffset += length;
+        return true;
+    }
+}
+
+bool CaptureReader::openSegment(){
+    auto segment = file_map_open(segment_path(mBasePath, mSegmentIndex));
+    if (!segment || segment->size < CAPTURE_SEGMENT_HEADER_LEN)
+        return false;
+
+    std::uint64_t magic;
+    std::memcpy(&magic, segment->address, sizeof(magic));
+    if (magic != CAPTURE_MAGIC)
+        return false;
+
+    mSegment = std::move(segment);
+    mOffset = CAPTURE_SEGMENT_HEADER_LEN;
+    return true;
+}
+
+CaptureReplayer::CaptureReplayer(std::string basePath, ReplaySpeed speed):
+    mBasePath(basePath),
+    mSpeed(speed){
+}
+
+void CaptureReplayer::setTcpDataReceivedCallback(std::function<void (std::uint32_t, ByteBuffer)> callback){
+    tcpDataReceivedCallback = callback;
+}
+
+void CaptureReplayer::setUdpDataReceivedCallback(std::function<void (ByteBuffer, std::string, PortNumberType)> callback){
+    udpDataReceivedCallback = callback;
+}
+
+std::size_t CaptureReplayer::replay(){
+    return replay([=](const CaptureRecord &record){
+        if (record.source == CaptureSource::TCP && tcpDataReceivedCallback)
+            tcpDataReceivedCallback(record.connectionId, record.data);
+        else if (record.source == CaptureSource::UDP && udpDataReceivedCallback)
+            udpDataReceivedCallback(record.data, record.address, record.port);
+    });
+}
+
+std::size_t CaptureReplayer::replay(std::function<void (const CaptureRecord &)> callback){
+    CaptureReader reader(mBasePath);
+    CaptureRecord record;
+    std::size_t count = 0;
+    TimePoint firstTimestamp;
+    auto replayStart = std::chrono::steady_clock::now();
+    while (reader.next(record)){
+        if (count == 0)
+            firstTimestamp = record.timestamp;
+        if (mSpeed == ReplaySpeed::RealTime)
+            std::this_thread::sleep_until(replayStart + (record.timestamp - firstTimestamp));
+        callback(record);
+        ++count;
+    }
+    return count;
+}
+
+std::size_t CaptureReplayer::replayTo(TcpClientSocket &socket, std::uint32_t connectionId){
+    std::size_t sent = 0;
+    replay([&](const CaptureRecord &record){
+        if (record.source == CaptureSource::TCP && record.connectionId == connectionId){
+            socket.send(record.data);
+            ++sent;
+        }
+    });
+    return sent;
+}
+
+std::size_t CaptureReplayer::replayTo(const std::map<std::uint32_t, TcpClientSocket *> &sockets){
+    std::size_t sent = 0;
+    replay([&](const CaptureRecord &record){
+        if (record.source != CaptureSource::TCP)
+            return;
+        auto socket = sockets.find(record.connectionId);
+        if (socket == sockets.end() || socket->second == nullptr)
+            return;
+        socket->second->send(record.data);
+        ++sent;
+    });
+    return sent;
+}
+
+std::size_t CaptureReplayer::replayTo(UdpSocket &socket){
+    return replay([&](const CaptureRecord &record){
+        if (record.source == CaptureSource::UDP)
+            socket.send(record.data);
+    });
+}
+
+}
+
+#endif
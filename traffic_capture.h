@@ -0,0 +1,122 @@
+#ifndef TRAFFIC_CAPTURE_H
+#define TRAFFIC_CAPTURE_H
+
+#include "net_types.h"
+
+#if defined(POSIX_OS)
+
+#include "posix/posix_shm.h"
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Net
+{
+
+class TcpClientSocket;
+class UdpSocket;
+class CaptureWriter;
+
+constexpr std::size_t CAPTURE_DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024;
+
+enum class CaptureSource: std::uint8_t {
+    TCP = 0,
+    UDP = 1
+};
+
+enum class ReplaySpeed{
+    RealTime,
+    Maximum
+};
+
+struct CaptureBinding{
+    std::shared_ptr<CaptureWriter> writer;
+    std::uint32_t connectionId;
+    std::string peerAddress;
+    PortNumberType peerPort;
+};
+
+struct CaptureRecord{
+    CaptureSource source;
+    std::uint32_t connectionId;
+    TimePoint timestamp;
+    std::string address;
+    PortNumberType port;
+    ByteBuffer data;
+};
+
+// The next segment is created and the previous one unmapped on a background
+// thread, so record() never does file I/O. Records that cannot be written,
+// because the next segment is not ready or the record is larger than a
+// segment, are counted by failedRecords() instead of throwing.
+class CaptureWriter{
+public:
+    CaptureWriter(std::string basePath, std::size_t segmentSize = CAPTURE_DEFAULT_SEGMENT_SIZE);
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter& operator=(const CaptureWriter &) = delete;
+    ~CaptureWriter();
+    void record(CaptureSource, std::uint32_t connectionId, TimePoint, const std::string &address, PortNumberType, const ByteBuffer &) noexcept;
+    std::size_t segmentCount() const;
+    std::uint64_t failedRecords() const;
+
+private:
+    std::string mBasePath;
+    std::size_t mSegmentSize;
+    mutable std::mutex mMutex;
+    std::condition_variable mPrepareCondition;
+    shared_memory_ptr mSegment;
+    shared_memory_ptr mSpareSegment;
+    shared_memory_ptr mRetiredSegment;
+    std::size_t mOffset{0};
+    std::size_t mSegmentIndex{0};
+    std::uint64_t mFailedRecords{0};
+    bool mStopped{false};
+    std::thread mPrepareThread;
+
+    shared_memory_ptr createSegment(std::size_t index);
+    void startPrepareLoop();
+};
+
+class CaptureReader{
+public:
+    CaptureReader(std::string basePath);
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader& operator=(const CaptureReader &) = delete;
+    bool next(CaptureRecord &);
+
+private:
+    std::string mBasePath;
+    shared_memory_ptr mSegment;
+    std::size_t mOffset{0};
+    std::size_t mSegmentIndex{0};
+
+    bool openSegment();
+};
+
+class CaptureReplayer{
+public:
+    CaptureReplayer(std::string basePath, ReplaySpeed = ReplaySpeed::RealTime);
+    void setTcpDataReceivedCallback(std::function<void(std::uint32_t, ByteBuffer)>);
+    void setUdpDataReceivedCallback(std::function<void(ByteBuffer, std::string, PortNumberType)>);
+    std::size_t replay();
+    std::size_t replay(std::function<void(const CaptureRecord &)>);
+    std::size_t replayTo(TcpClientSocket &, std::uint32_t connectionId);
+    std::size_t replayTo(const std::map<std::uint32_t, TcpClientSocket *> &);
+    std::size_t replayTo(UdpSocket &);
+
+private:
+    std::string mBasePath;
+    ReplaySpeed mSpeed;
+    std::function<void(std::uint32_t, ByteBuffer)> tcpDataReceivedCallback;
+    std::function<void(ByteBuffer, std::string, PortNumberType)> udpDataReceivedCallback;
+};
+
+}
+
+#endif
+#endif // TRAFFIC_CAPTURE_H
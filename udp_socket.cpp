@@ -6,7 +6,9 @@
 namespace Net
 {
 
-UdpSocket::UdpSocket(PortNumberType port){
+UdpSocket::UdpSocket(PortNumberType port, bool shareAddress, ThreadConfig receiveThread):
+    mSharedAddress(shareAddress),
+    mThreadConfig(receiveThread){
     auto addresInfo = get_addr_info(SocketType::UDP, port);
     if(!addresInfo)
         throw std::runtime_error("Unable to create address info");
@@ -15,6 +17,11 @@ UdpSocket::UdpSocket(PortNumberType port){
     if (!this->mSocket)
         throw std::runtime_error("Unable to create socket");
 
+    if (shareAddress && !socket_set_reuse_address(this->mSocket)){
+        socket_close(mSocket);
+        throw std::runtime_error("Unable to share socket address");
+    }
+
     if (!socket_bind(this->mSocket, addresInfo)){        
         socket_close(mSocket);
         throw std::runtime_error("Unable to bind socket");
@@ -24,9 +31,13 @@ UdpSocket::UdpSocket(PortNumberType port){
 }
 
 UdpSocket::~UdpSocket(){
+    if (mSendQueue)
+        mSendQueue->close(SEND_QUEUE_DRAIN_TIMEOUT);
     try{
     isReceiving.store(false);
+    mFlowControl.wake();
     socket_shutdown(mSocket);
+    mSendQueue.reset();
     if (receiveThread.joinable())
         receiveThread.join();
     }
@@ -42,25 +53,189 @@ bool UdpSocket::sendTo(std::string address, PortNumberType port, const ByteBuffe
         assert(false);
         return false;
     }
+    if (mSendQueue){
+        auto destination = std::make_shared<addr_info_ptr>(std::move(addressInfo));
+        return mSendQueue->enqueue(data.size(), [this, destination, data](){
+            if (!socket_send_to(mSocket, *destination, data))
+                throw std::runtime_error(std::string("Send error. Error code: ") + std::to_string(get_last_error()));
+        });
+    }
     return socket_send_to(mSocket, addressInfo, data);
 }
 
+bool UdpSocket::setDestination(std::string address, PortNumberType port){
+    auto addressInfo = get_addr_info(SocketType::UDP, port, address);
+    if (!addressInfo)
+        return false;
+    mDestination = std::make_shared<addr_info_ptr>(std::move(addressInfo));
+    return true;
+}
+
+bool UdpSocket::send(const ByteBuffer &data){
+    if (!mDestination)
+        throw std::runtime_error("Destination is not set");
+    if (mSendQueue){
+        auto destination = mDestination;
+        return mSendQueue->enqueue(data.size(), [this, destination, data](){
+            if (!socket_send_to(mSocket, *destination, data))
+                throw std::runtime_error(std::string("Send error. Error code: ") + std::to_string(get_last_error()));
+        });
+    }
+    return socket_send_to(mSocket, *mDestination, data);
+}
+
+void UdpSocket::setRateLimiter(std::shared_ptr<TokenBucket> rateLimiter){
+    if (!mSendQueue)
+        createSendQueue(rateLimiter);
+    else
+        mSendQueue->setRateLimiter(rateLimiter);
+}
+
+void UdpSocket::setSendQueueCapacity(std::size_t capacity){
+    mSendQueueCapacity = capacity;
+    if (mSendQueue)
+        mSendQueue->setCapacity(capacity);
+}
+
+SendQueueStatistics UdpSocket::sendQueueStatistics() const{
+    if (!mSendQueue)
+        return SendQueueStatistics{0, 0, 0, 0, 0};
+    return mSendQueue->statistics();
+}
+
+void UdpSocket::setSendErrorCallback(std::function<void (std::string)> callback){
+    sendErrorCallback = callback;
+}
+
+void UdpSocket::createSendQueue(std::shared_ptr<TokenBucket> rateLimiter){
+    mSendQueue.reset(new SendQueue(rateLimiter, mSendQueueCapacity));
+    mSendQueue->setErrorCallback([this](const std::string &error){
+        if (sendErrorCallback)
+            sendErrorCallback(error);
+        else
+            std::cerr<< "Failed to send queued data: " << error <<std::endl;
+    });
+}
+
+bool UdpSocket::setMaxPacingRate(std::uint64_t bytesPerSecond){
+    return socket_set_max_pacing_rate(mSocket, bytesPerSecond);
+}
+
+DurationStatistics UdpSocket::pacingDelay() const{
+    if (!mSendQueue)
+        return DurationRecorder().statistics();
+    return mSendQueue->queueDelay();
+}
+
+bool UdpSocket::joinGroup(std::string group, std::string interfaceAddress){
+    return socket_join_group(mSocket, group, interfaceAddress);
+}
+
+bool UdpSocket::leaveGroup(std::string group, std::string interfaceAddress){
+    return socket_leave_group(mSocket, group, interfaceAddress);
+}
+
+bool UdpSocket::joinSourceGroup(std::string group, std::string source, std::string interfaceAddress){
+    return socket_join_source_group(mSocket, group, source, interfaceAddress);
+}
+
+bool UdpSocket::leaveSourceGroup(std::string group, std::string source, std::string interfaceAddress){
+    return socket_leave_source_group(mSocket, group, source, interfaceAddress);
+}
+
+bool UdpSocket::setMulticastInterface(std::string interfaceAddress){
+    return socket_set_multicast_interface(mSocket, interfaceAddress);
+}
+
+bool UdpSocket::setMulticastTtl(int ttl){
+    return socket_set_multicast_ttl(mSocket, ttl);
+}
+
+bool UdpSocket::setMulticastLoopback(bool enabled){
+    return socket_set_multicast_loopback(mSocket, enabled);
+}
+
+bool UdpSocket::enableKernelTimestamps(){
+    if (!socket_enable_timestamps(mSocket))
+        return false;
+    mKernelTimestamps.store(true);
+    return true;
+}
+
 void UdpSocket::setDataReceivedCallback(std::function<void (ByteBuffer, std::string, PortNumberType)> callback){
     dataReceivedCallback = callback;
 }
 
+void UdpSocket::setTimestampedDataReceivedCallback(std::function<void (ByteBuffer, std::string, PortNumberType, TimePoint)> callback){
+    timestampedDataReceivedCallback = callback;
+}
+
+ReceiveLatency UdpSocket::receiveLatency() const{
+    return ReceiveLatency{mArrivalToDispatch.statistics(), mCallbackDuration.statistics()};
+}
+
+void UdpSocket::pauseReading(){
+    mFlowControl.pause();
+}
+
+void UdpSocket::resumeReading(){
+    mFlowControl.resume();
+}
+
+bool UdpSocket::isReadingPaused() const{
+    return mFlowControl.paused();
+}
+
+void UdpSocket::setReceiveBudget(std::size_t highWatermark, std::size_t lowWatermark){
+    mFlowControl.setWatermarks(highWatermark, lowWatermark);
+}
+
+void UdpSocket::releaseReceivedBytes(std::size_t bytes){
+    mFlowControl.consumed(bytes);
+}
+
+#if defined(POSIX_OS)
+void UdpSocket::setCapture(std::shared_ptr<CaptureWriter> capture, std::uint32_t connectionId){
+    std::shared_ptr<const CaptureBinding> binding;
+    if (capture)
+        binding = std::make_shared<CaptureBinding>(CaptureBinding{capture, connectionId, std::string(), 0});
+    std::atomic_store(&mCapture, binding);
+}
+#endif
+
 void UdpSocket::startReceiveLoop(){
     receiveThread = std::thread([=](){
+        if (mSharedAddress)
+            apply_thread_config(IoThreadRole::UdpReceive, mThreadConfig, mSocket);
+        else
+            apply_thread_config(IoThreadRole::UdpReceive, mThreadConfig);
         while(isReceiving.load()){
             if (!socket_valid(mSocket))
                 return;
+            if (!mFlowControl.waitUntilReadable(FLOW_CONTROL_POLL_INTERVAL))
+                continue;
             auto addrInfo = get_addr_info(SocketType::UDP,0);
             try{
-                auto data = socket_receive_from(mSocket, addrInfo);
+                TimePoint arrivalTime;
+                auto data = socket_receive_from(mSocket, addrInfo, arrivalTime);
 
                 if(data.size()==0)
                     return;
-                if (dataReceivedCallback) dataReceivedCallback(data, "", 123);
+                if (mKernelTimestamps.load())
+                    mArrivalToDispatch.record(std::chrono::system_clock::now() - arrivalTime);
+                std::string senderAddress;
+                PortNumberType senderPort = 0;
+                get_endpoint(addrInfo, senderAddress, senderPort);
+#if defined(POSIX_OS)
+                auto capture = std::atomic_load(&mCapture);
+                if (capture)
+                    capture->writer->record(CaptureSource::UDP, capture->connectionId, arrivalTime, senderAddress, senderPort, data);
+#endif
+                mFlowControl.delivered(data.size());
+                auto callbackStart = std::chrono::steady_clock::now();
+                if (timestampedDataReceivedCallback) timestampedDataReceivedCallback(data, senderAddress, senderPort, arrivalTime);
+                if (dataReceivedCallback) dataReceivedCallback(data, senderAddress, senderPort);
+                mCallbackDuration.record(std::chrono::steady_clock::now() - callbackStart);
             }
             catch (std::runtime_error &e){
                 std::cerr<< "Failed to recive data: " << e.what() <<std::endl;
@@ -72,6 +72,32 @@ addr_info_ptr get_addr_info(SocketType socket_type, PortNumberType port, std::st
     return res;
 }
 
+bool get_endpoint(const addr_info_ptr &address_info, std::string &address, PortNumberType &port) noexcept {
+    if (!address_info || address_info->ai_addr == nullptr || address_info->ai_addr->sa_family != AF_INET)
+        return false;
+    auto socketAddress = reinterpret_cast<const sockaddr_in *>(address_info->ai_addr);
+    char buffer[INET_ADDRSTRLEN];
+    if (inet_ntop(AF_INET, &socketAddress->sin_addr, buffer, sizeof(buffer)) == nullptr)
+        return false;
+    address = buffer;
+    port = ntohs(socketAddress->sin_port);
+    return true;
+}
+
+bool get_peer_endpoint(const socket_t &socket, std::string &address, PortNumberType &port) noexcept {
+    sockaddr_storage peer;
+    int length = sizeof(peer);
+    if (socket == INVALID_SOCKET || getpeername(socket, reinterpret_cast<sockaddr *>(&peer), &length) == SOCKET_ERROR || peer.ss_family != AF_INET)
+        return false;
+    auto socketAddress = reinterpret_cast<const sockaddr_in *>(&peer);
+    char buffer[INET_ADDRSTRLEN];
+    if (inet_ntop(AF_INET, &socketAddress->sin_addr, buffer, sizeof(buffer)) == nullptr)
+        return false;
+    address = buffer;
+    port = ntohs(socketAddress->sin_port);
+    return true;
+}
+
 socket_t create_socket(const addr_info_ptr &address_info) noexcept {
     assert(address_info);
     return socket(address_info->ai_family, address_info->ai_socktype, address_info->ai_protocol);
@@ -151,6 +177,18 @@ ByteBuffer socket_receive_from(socket_t &socket, addr_info_ptr &addr_info){
     return message;
 }
 
+ByteBuffer socket_receive(socket_t &socket, TimePoint &timestamp){
+    auto message = socket_receive(socket);
+    timestamp = std::chrono::system_clock::now();
+    return message;
+}
+
+ByteBuffer socket_receive_from(socket_t &socket, addr_info_ptr &addr_info, TimePoint &timestamp){
+    auto message = socket_receive_from(socket, addr_info);
+    timestamp = std::chrono::system_clock::now();
+    return message;
+}
+
 bool socket_send(socket_t &socket, const ByteBuffer &message) noexcept {
     assert(socket != INVALID_SOCKET);
     auto sendBuffer = reinterpret_cast<const char *>(message.data());
@@ -171,6 +209,22 @@ bool socket_send_to(socket_t &socket, const addr_info_ptr &addr_info, const Byte
     return true;
 }
 
+bool socket_connection_lost(socket_t &socket) noexcept {
+    assert(socket != INVALID_SOCKET);
+    WSAPOLLFD descriptor;
+    descriptor.fd = socket;
+    descriptor.events = POLLRDNORM;
+    descriptor.revents = 0;
+    if (WSAPoll(&descriptor, 1, 0) == SOCKET_ERROR)
+        return false;
+    if ((descriptor.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+        return true;
+    if ((descriptor.revents & POLLRDNORM) == 0)
+        return false;
+    char next;
+    return recv(socket, &next, 1, MSG_PEEK) == 0;
+}
+
 bool socket_shutdown(socket_t &socket) noexcept {
     assert(socket != INVALID_SOCKET);
     if (shutdown(socket, SD_BOTH) == SOCKET_ERROR)
@@ -182,6 +236,93 @@ void socket_close(socket_t &socket) noexcept {
     closesocket(socket);
 }
 
+static bool parse_ipv4(const std::string &address, in_addr &result) noexcept {
+    if (address.empty()){
+        result.s_addr = htonl(INADDR_ANY);
+        return true;
+    }
+    return inet_pton(AF_INET, address.c_str(), &result) == 1;
+}
+
+static bool socket_group_membership(socket_t &socket, int option, const std::string &group, const std::string &interface_address) noexcept {
+    assert(socket != INVALID_SOCKET);
+    ip_mreq request;
+    ZeroMemory(&request, sizeof(request));
+    if (group.empty() || !parse_ipv4(group, request.imr_multiaddr) || !parse_ipv4(interface_address, request.imr_interface))
+        return false;
+    return setsockopt(socket, IPPROTO_IP, option, reinterpret_cast<const char *>(&request), sizeof(request)) != SOCKET_ERROR;
+}
+
+static bool socket_source_group_membership(socket_t &socket, int option, const std::string &group, const std::string &source, const std::string &interface_address) noexcept {
+    assert(socket != INVALID_SOCKET);
+    ip_mreq_source request;
+    ZeroMemory(&request, sizeof(request));
+    if (group.empty() || source.empty()
+            || !parse_ipv4(group, request.imr_multiaddr)
+            || !parse_ipv4(source, request.imr_sourceaddr)
+            || !parse_ipv4(interface_address, request.imr_interface))
+        return false;
+    return setsockopt(socket, IPPROTO_IP, option, reinterpret_cast<const char *>(&request), sizeof(request)) != SOCKET_ERROR;
+}
+
+bool socket_set_reuse_address(socket_t &socket) noexcept {
+    assert(socket != INVALID_SOCKET);
+    int enable = 1;
+    if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&enable), sizeof(enable)) == SOCKET_ERROR)
+        return false;
+    return true;
+}
+
+bool socket_join_group(socket_t &socket, const std::string &group, const std::string &interface_address) noexcept {
+    return socket_group_membership(socket, IP_ADD_MEMBERSHIP, group, interface_address);
+}
+
+bool socket_leave_group(socket_t &socket, const std::string &group, const std::string &interface_address) noexcept {
+    return socket_group_membership(socket, IP_DROP_MEMBERSHIP, group, interface_address);
+}
+
+bool socket_join_source_group(socket_t &socket, const std::string &group, const std::string &source, const std::string &interface_address) noexcept {
+    return socket_source_group_membership(socket, IP_ADD_SOURCE_MEMBERSHIP, group, source, interface_address);
+}
+
+bool socket_leave_source_group(socket_t &socket, const std::string &group, const std::string &source, const std::string &interface_address) noexcept {
+    return socket_source_group_membership(socket, IP_DROP_SOURCE_MEMBERSHIP, group, source, interface_address);
+}
+
+bool socket_set_multicast_interface(socket_t &socket, const std::string &interface_address) noexcept {
+    assert(socket != INVALID_SOCKET);
+    in_addr address;
+    if (!parse_ipv4(interface_address, address))
+        return false;
+    return setsockopt(socket, IPPROTO_IP, IP_MULTICAST_IF, reinterpret_cast<const char *>(&address), sizeof(address)) != SOCKET_ERROR;
+}
+
+bool socket_set_multicast_ttl(socket_t &socket, int ttl) noexcept {
+    assert(socket != INVALID_SOCKET);
+    if (ttl < 0 || ttl > 255)
+        return false;
+    auto value = static_cast<DWORD>(ttl);
+    return setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char *>(&value), sizeof(value)) != SOCKET_ERROR;
+}
+
+bool socket_set_multicast_loopback(socket_t &socket, bool enable) noexcept {
+    assert(socket != INVALID_SOCKET);
+    DWORD value = enable ? 1 : 0;
+    return setsockopt(socket, IPPROTO_IP, IP_MULTICAST_LOOP, reinterpret_cast<const char *>(&value), sizeof(value)) != SOCKET_ERROR;
+}
+
+bool socket_enable_timestamps(socket_t &) noexcept {
+    return false;
+}
+
+bool socket_set_max_pacing_rate(socket_t &, std::uint64_t) noexcept {
+    return false;
+}
+
+bool socket_set_incoming_cpu(socket_t &, int) noexcept {
+    return false;
+}
+
 }
 
 #endif
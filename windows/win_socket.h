@@ -4,6 +4,7 @@
 #include "../net_types.h"
 #ifdef WIN_OS
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <winsock2.h>
@@ -23,6 +24,8 @@ void sockets_cleanup() noexcept;
 int get_last_error() noexcept;
 socket_t get_default_socket() noexcept;
 addr_info_ptr get_addr_info(SocketType, PortNumberType, std::string address = std::string()) noexcept;
+bool get_endpoint(const addr_info_ptr &, std::string &address, PortNumberType &port) noexcept;
+bool get_peer_endpoint(const socket_t &, std::string &address, PortNumberType &port) noexcept;
 socket_t create_socket(const addr_info_ptr &) noexcept;
 bool socket_valid(const socket_t &) noexcept;
 bool socket_bind(socket_t &, const addr_info_ptr &) noexcept;
@@ -31,10 +34,24 @@ socket_t socket_accept(socket_t &) noexcept;
 bool socket_connect(socket_t &, const addr_info_ptr &) noexcept;
 ByteBuffer socket_receive(socket_t &);
 ByteBuffer socket_receive_from(socket_t &, addr_info_ptr &);
+ByteBuffer socket_receive(socket_t &, TimePoint &);
+ByteBuffer socket_receive_from(socket_t &, addr_info_ptr &, TimePoint &);
 bool socket_send(socket_t &, const ByteBuffer &) noexcept;
 bool socket_send_to(socket_t &, const addr_info_ptr &, const ByteBuffer &) noexcept;
+bool socket_connection_lost(socket_t &) noexcept;
 bool socket_shutdown(socket_t &) noexcept;
 void socket_close(socket_t &) noexcept;
+bool socket_set_reuse_address(socket_t &) noexcept;
+bool socket_join_group(socket_t &, const std::string &group, const std::string &interface_address) noexcept;
+bool socket_leave_group(socket_t &, const std::string &group, const std::string &interface_address) noexcept;
+bool socket_join_source_group(socket_t &, const std::string &group, const std::string &source, const std::string &interface_address) noexcept;
+bool socket_leave_source_group(socket_t &, const std::string &group, const std::string &source, const std::string &interface_address) noexcept;
+bool socket_set_multicast_interface(socket_t &, const std::string &interface_address) noexcept;
+bool socket_set_multicast_ttl(socket_t &, int) noexcept;
+bool socket_set_multicast_loopback(socket_t &, bool) noexcept;
+bool socket_enable_timestamps(socket_t &) noexcept;
+bool socket_set_max_pacing_rate(socket_t &, std::uint64_t bytes_per_second) noexcept;
+bool socket_set_incoming_cpu(socket_t &, int cpu) noexcept;
 
 }
 
@@ -0,0 +1,28 @@
+#include "win_thread.h"
+
+#ifdef WIN_OS
+#include <windows.h>
+
+namespace Net {
+
+bool thread_set_name(const std::string &) noexcept {
+    return false;
+}
+
+bool thread_set_affinity(const std::vector<int> &cpus) noexcept {
+    DWORD_PTR mask = 0;
+    for (auto cpu : cpus){
+        if (cpu < 0 || cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8))
+            return false;
+        mask |= DWORD_PTR(1) << cpu;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+}
+
+bool thread_set_fifo_priority(int) noexcept {
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+}
+
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef WIN_THREAD_H
+#define WIN_THREAD_H
+
+#include "../net_types.h"
+#ifdef WIN_OS
+
+#include <string>
+#include <vector>
+
+namespace Net
+{
+
+bool thread_set_name(const std::string &) noexcept;
+bool thread_set_affinity(const std::vector<int> &cpus) noexcept;
+bool thread_set_fifo_priority(int priority) noexcept;
+
+}
+
+#endif
+
+#endif // WIN_THREAD_H